@@ -1,7 +1,12 @@
-#include "perlin_sse.h"
+#include "perlin_avx.h"
+
+// this file is built once per ISA (PERLIN_NAMESPACE + flags, see CMakeLists.txt).
+// keep everything inside the namespace and stay away from std:: inline helpers
+// (std::floor & co), their out-of-line copies would be shared between variants.
+namespace PERLIN_NAMESPACE {
 
 // only works for 512 for now
-unsigned int permutation[512] = 
+const unsigned int permutation[512] = 
 {
     151,160,137,91,90,15,
     131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
@@ -32,22 +37,9 @@ unsigned int permutation[512] =
     138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
 };
 
-f32_4x _127p5f = F32_4X(127.5);
-f32_4x _15f = F32_4X(15);
-f32_4x _10f = F32_4X(10);
-f32_4x _6f  = F32_4X(6);
-f32_4x _2f  = F32_4X(2);
-f32_4x _1f  = F32_4X(1);
-f32_4x _n1f = F32_4X(-1);
-
-// pack scalars
-u32_4x _15u = U32_4X(15);
-u32_4x _14u = U32_4X(14);
-u32_4x _12u = U32_4X(12);
-u32_4x _8u  = U32_4X(8);
-u32_4x _4u  = U32_4X(4);
-u32_4x _2u  = U32_4X(2);
-u32_4x _1u  = U32_4X(1);
+// no global f32_4x constants: their initializers would run at startup with
+// this variant's ISA, even on a cpu that never selects it. splat locally,
+// the compiler turns these into constant loads anyway.
 
 template<typename T> 
 class Vec2 
@@ -81,14 +73,27 @@ f32 lerp(const f32 &t, const f32 &a, const f32 &b) { return a + t * (b-a); }
 
 f32_4x lerp_4x(const f32_4x &t, const f32_4x &a, const f32_4x &b) { return a + t * (b-a); }
 
+f32_8x lerp_8x(const f32_8x &t, const f32_8x &a, const f32_8x &b) { return a + t * (b-a); }
+
 inline
 f32 quintic(const f32 &t) { return t * t * t * (t * (t * 6 - 15) + 10); }
 
 f32_4x quintic_4x(const f32_4x &t) {
 
+    f32_4x _15f = F32_4X(15);
+    f32_4x _10f = F32_4X(10);
+    f32_4x _6f  = F32_4X(6);
     return t * t * t * (t * (t * _6f - _15f) + _10f);
 }
 
+f32_8x quintic_8x(const f32_8x &t) {
+
+    f32_8x _15f_8x = F32_8X(15);
+    f32_8x _10f_8x = F32_8X(10);
+    f32_8x _6f_8x  = F32_8X(6);
+    return t * t * t * (t * (t * _6f_8x - _15f_8x) + _10f_8x);
+}
+
 // calculates dot product with vector of the regular tetrahedron
 f32 gradient (uint8_t hash, f32 x, f32 y, f32 z) {
 
@@ -112,6 +117,15 @@ f32 gradient (uint8_t hash, f32 x, f32 y, f32 z) {
 
 f32_4x gradient_4x (u32_4x hash, f32_4x x, f32_4x y, f32_4x z) {
 
+    f32_4x _n1f = F32_4X(-1);
+    u32_4x _15u = U32_4X(15);
+    u32_4x _14u = U32_4X(14);
+    u32_4x _12u = U32_4X(12);
+    u32_4x _8u  = U32_4X(8);
+    u32_4x _4u  = U32_4X(4);
+    u32_4x _2u  = U32_4X(2);
+    u32_4x _1u  = U32_4X(1);
+
     auto h = hash & _15u;
 
     auto uSel = h < _8u;
@@ -131,15 +145,44 @@ f32_4x gradient_4x (u32_4x hash, f32_4x x, f32_4x y, f32_4x z) {
     return R0 + R1;
 }
 
+f32_8x gradient_8x (u32_8x hash, f32_8x x, f32_8x y, f32_8x z) {
+
+    f32_8x _n1f_8x = F32_8X(-1);
+    u32_8x _15u_8x = U32_8X(15);
+    u32_8x _14u_8x = U32_8X(14);
+    u32_8x _12u_8x = U32_8X(12);
+    u32_8x _8u_8x  = U32_8X(8);
+    u32_8x _4u_8x  = U32_8X(4);
+    u32_8x _2u_8x  = U32_8X(2);
+    u32_8x _1u_8x  = U32_8X(1);
+
+    auto h = hash & _15u_8x;
+
+    auto uSel = h < _8u_8x;
+    auto vSel = h < _4u_8x;
+    auto xSel = (h == _12u_8x | h == _14u_8x);
+
+    auto u  = _select(uSel, x, y);
+    auto xz = _select(xSel, x, z);
+    auto v  = _select(vSel, y, xz);
+
+    auto uFlip = (h & _1u_8x) == _1u_8x;
+    auto vFlip = (h & _2u_8x) == _2u_8x;
+
+    auto R0 = _select(uFlip, _n1f_8x*u, u);
+    auto R1 = _select(vFlip, _n1f_8x*v, v);
+    return R0 + R1;
+}
+
 f32 perlinNoise(const Vec3f &p) 
 {
-    int X = ((int)std::floor(p.x)) & kMaxTableSizeMask; // find cube of point
-    int Y = ((int)std::floor(p.y)) & kMaxTableSizeMask;
-    int Z = ((int)std::floor(p.z)) & kMaxTableSizeMask;
+    int X = ((int)floorf(p.x)) & kMaxTableSizeMask; // find cube of point
+    int Y = ((int)floorf(p.y)) & kMaxTableSizeMask;
+    int Z = ((int)floorf(p.z)) & kMaxTableSizeMask;
 
-    f32 x = p.x - std::floor(p.x);  // find relative x,y,z in cube
-    f32 y = p.y - std::floor(p.y);
-    f32 z = p.z - std::floor(p.z);
+    f32 x = p.x - floorf(p.x);  // find relative x,y,z in cube
+    f32 y = p.y - floorf(p.y);
+    f32 z = p.z - floorf(p.z);
 
     f32 u = quintic(x);
     f32 v = quintic(y);
@@ -184,13 +227,13 @@ f32 perlinNoise(const Vec3f &p)
 
 f32 perlinNoiseSIMD(const Vec3f &p) 
 {
-    int X = ((int)std::floor(p.x)) & kMaxTableSizeMask; // find cube of point
-    int Y = ((int)std::floor(p.y)) & kMaxTableSizeMask;
-    int Z = ((int)std::floor(p.z)) & kMaxTableSizeMask;
+    int X = ((int)floorf(p.x)) & kMaxTableSizeMask; // find cube of point
+    int Y = ((int)floorf(p.y)) & kMaxTableSizeMask;
+    int Z = ((int)floorf(p.z)) & kMaxTableSizeMask;
 
-    f32 x = p.x - std::floor(p.x);  // find relative x,y,z in cube
-    f32 y = p.y - std::floor(p.y);
-    f32 z = p.z - std::floor(p.z);
+    f32 x = p.x - floorf(p.x);  // find relative x,y,z in cube
+    f32 y = p.y - floorf(p.y);
+    f32 z = p.z - floorf(p.z);
 
     f32 u = quintic(x);
     f32 v = quintic(y);
@@ -237,27 +280,29 @@ f32 perlinNoiseSIMD(const Vec3f &p)
     return res;
 }
 
-void perlinNoiseSIMD_4x(const f32 x, const f32 y, const f32 z, const f32 f, uint8_t *data) 
+// 4 samples at x, x+f, x+2f, x+3f, in [-1, 1]
+f32_4x noise_4x(const f32 x, const f32 y, const f32 z, const f32 f) 
 {
 
     u32_4x mask = U32_4X(kMaxTableSizeMask);
+    f32_4x _1f = F32_4X(1);
 
     f32_4x X_4x = F32_4X(x, x+f, x+f+f, x+f+f+f);
     f32_4x Y_4x = F32_4X(y);
     f32_4x Z_4x = F32_4X(z);
 
-    u32_4x XI_4x = U32_4X(vcvtq_u32_f32(X_4x.sse));
-    u32_4x YI_4x = U32_4X(vcvtq_u32_f32(Y_4x.sse));
-    u32_4x ZI_4x = U32_4X(vcvtq_u32_f32(Z_4x.sse));
+    u32_4x XI_4x = _cvt_u32(X_4x);
+    u32_4x YI_4x = _cvt_u32(Y_4x);
+    u32_4x ZI_4x = _cvt_u32(Z_4x);
 
     u32_4x XM_4x = XI_4x & mask;
     u32_4x YM_4x = YI_4x & mask;
     u32_4x ZM_4x = ZI_4x & mask;
 
     // x - std::floor(x)
-    f32_4x SX_4x = X_4x - F32_4X(vcvtq_f32_u32(XI_4x.sse));
-    f32_4x SY_4x = Y_4x - F32_4X(vcvtq_f32_u32(YI_4x.sse));
-    f32_4x SZ_4x = Z_4x - F32_4X(vcvtq_f32_u32(ZI_4x.sse));
+    f32_4x SX_4x = X_4x - _cvt_f32(XI_4x);
+    f32_4x SY_4x = Y_4x - _cvt_f32(YI_4x);
+    f32_4x SZ_4x = Z_4x - _cvt_f32(ZI_4x);
 
     // (x - std::floor(x)) - 1
     f32_4x NSX_4x = SX_4x - _1f;
@@ -268,82 +313,24 @@ void perlinNoiseSIMD_4x(const f32 x, const f32 y, const f32 z, const f32 f, uint
     f32_4x v_4x = quintic_4x(SY_4x);
     f32_4x w_4x = quintic_4x(SZ_4x);
 
-    u32 A_0  = permutation[XM_4x.E[0]]   + Y_4x.E[0];
-    u32 AA_0 = permutation[A_0]          + Z_4x.E[0];
-    u32 AB_0 = permutation[A_0+1]        + Z_4x.E[0];
-    u32 B_0  = permutation[XM_4x.E[0]+1] + Y_4x.E[0];
-    u32 BA_0 = permutation[B_0]          + Z_4x.E[0];
-    u32 BB_0 = permutation[B_0+1]        + Z_4x.E[0];
-
-    u32 H0_0 = permutation[AA_0];
-    u32 H1_0 = permutation[BA_0];
-    u32 H2_0 = permutation[AB_0];
-    u32 H3_0 = permutation[BB_0];
-    u32 H4_0 = permutation[AA_0+1];
-    u32 H5_0 = permutation[BA_0+1];
-    u32 H6_0 = permutation[AB_0+1];
-    u32 H7_0 = permutation[BB_0+1];
-
-
-    u32 A_1  = permutation[XM_4x.E[1]]   + Y_4x.E[1];
-    u32 AA_1 = permutation[A_1]          + Z_4x.E[1];
-    u32 AB_1 = permutation[A_1+1]        + Z_4x.E[1];
-    u32 B_1  = permutation[XM_4x.E[1]+1] + Y_4x.E[1];
-    u32 BA_1 = permutation[B_1]          + Z_4x.E[1];
-    u32 BB_1 = permutation[B_1+1]        + Z_4x.E[1];
-
-    u32 H0_1 = permutation[AA_1];
-    u32 H1_1 = permutation[BA_1];
-    u32 H2_1 = permutation[AB_1];
-    u32 H3_1 = permutation[BB_1];
-    u32 H4_1 = permutation[AA_1+1];
-    u32 H5_1 = permutation[BA_1+1];
-    u32 H6_1 = permutation[AB_1+1];
-    u32 H7_1 = permutation[BB_1+1];
-
-
-    u32 A_2  = permutation[XM_4x.E[2]]   + Y_4x.E[2];
-    u32 AA_2 = permutation[A_2]          + Z_4x.E[2];
-    u32 AB_2 = permutation[A_2+1]        + Z_4x.E[2];
-    u32 B_2  = permutation[XM_4x.E[2]+1] + Y_4x.E[2];
-    u32 BA_2 = permutation[B_2]          + Z_4x.E[2];
-    u32 BB_2 = permutation[B_2+1]        + Z_4x.E[2];
-
-    u32 H0_2 = permutation[AA_2];
-    u32 H1_2 = permutation[BA_2];
-    u32 H2_2 = permutation[AB_2];
-    u32 H3_2 = permutation[BB_2];
-    u32 H4_2 = permutation[AA_2+1];
-    u32 H5_2 = permutation[BA_2+1];
-    u32 H6_2 = permutation[AB_2+1];
-    u32 H7_2 = permutation[BB_2+1];
-
-
-    u32 A_3  = permutation[XM_4x.E[3]]   + Y_4x.E[3];
-    u32 AA_3 = permutation[A_3]          + Z_4x.E[3];
-    u32 AB_3 = permutation[A_3+1]        + Z_4x.E[3];
-    u32 B_3  = permutation[XM_4x.E[3]+1] + Y_4x.E[3];
-    u32 BA_3 = permutation[B_3]          + Z_4x.E[3];
-    u32 BB_3 = permutation[B_3+1]        + Z_4x.E[3];
-
-    u32 H0_3 = permutation[AA_3];
-    u32 H1_3 = permutation[BA_3];
-    u32 H2_3 = permutation[AB_3];
-    u32 H3_3 = permutation[BB_3];
-    u32 H4_3 = permutation[AA_3+1];
-    u32 H5_3 = permutation[BA_3+1];
-    u32 H6_3 = permutation[AB_3+1];
-    u32 H7_3 = permutation[BB_3+1];
-
-
-    u32_4x H0 = U32_4X (H0_0, H0_1, H0_2, H0_3);
-    u32_4x H1 = U32_4X (H1_0, H1_1, H1_2, H1_3);
-    u32_4x H2 = U32_4X (H2_0, H2_1, H2_2, H2_3);
-    u32_4x H3 = U32_4X (H3_0, H3_1, H3_2, H3_3);
-    u32_4x H4 = U32_4X (H4_0, H4_1, H4_2, H4_3);
-    u32_4x H5 = U32_4X (H5_0, H5_1, H5_2, H5_3);
-    u32_4x H6 = U32_4X (H6_0, H6_1, H6_2, H6_3);
-    u32_4x H7 = U32_4X (H7_0, H7_1, H7_2, H7_3);
+    u32_4x _1u = U32_4X(1);
+
+    // indices stay below 512, see permutation[]
+    u32_4x A  = _gather(permutation, XM_4x)       + YM_4x;
+    u32_4x AA = _gather(permutation, A)           + ZM_4x;
+    u32_4x AB = _gather(permutation, A + _1u)     + ZM_4x;
+    u32_4x B  = _gather(permutation, XM_4x + _1u) + YM_4x;
+    u32_4x BA = _gather(permutation, B)           + ZM_4x;
+    u32_4x BB = _gather(permutation, B + _1u)     + ZM_4x;
+
+    u32_4x H0 = _gather(permutation, AA);
+    u32_4x H1 = _gather(permutation, BA);
+    u32_4x H2 = _gather(permutation, AB);
+    u32_4x H3 = _gather(permutation, BB);
+    u32_4x H4 = _gather(permutation, AA + _1u);
+    u32_4x H5 = _gather(permutation, BA + _1u);
+    u32_4x H6 = _gather(permutation, AB + _1u);
+    u32_4x H7 = _gather(permutation, BB + _1u);
 
 
     f32_4x G0 = gradient_4x(H0, SX_4x,  SY_4x,  SZ_4x); 
@@ -366,152 +353,564 @@ void perlinNoiseSIMD_4x(const f32 x, const f32 y, const f32 z, const f32 f, uint
     f32_4x L5 = lerp_4x(v_4x, L0, L1);
     f32_4x L6 = lerp_4x(v_4x, L2, L3);
 
-    f32_4x result = lerp_4x(w_4x, L5, L6);
-    result = (result + _1f) * _127p5f;
+    return lerp_4x(w_4x, L5, L6);
+}
+
+// quantized to [0, 255]
+void perlinNoiseSIMD_4x(const f32 x, const f32 y, const f32 z, const f32 f, uint8_t *data) 
+{
+    f32_4x result = (noise_4x(x, y, z, f) + F32_4X(1)) * F32_4X(127.5);
+
+    // never negative, so truncating is floor
+    u32_4x quantized = _cvt_u32(result);
 
-    data[0] = std::floor(result.E[0]);
-    data[1] = std::floor(result.E[1]);
-    data[2] = std::floor(result.E[2]);
-    data[3] = std::floor(result.E[3]);
+    data[0] = quantized.E[0];
+    data[1] = quantized.E[1];
+    data[2] = quantized.E[2];
+    data[3] = quantized.E[3];
 }
 
-void perlinNoiseSIMD_8x(const f32 x, const f32 y, const f32 z, const f32 f, f32 *data) 
+// raw [-1, 1] density, stored straight from the register
+void perlinNoiseSIMD_4x_f32(const f32 x, const f32 y, const f32 z, const f32 f, f32 *data) 
 {
+    _store(data, noise_4x(x, y, z, f));
+}
 
-    u32_4x mask = U32_4X(kMaxTableSizeMask);
+// lattice cell, fraction and fade of the y/z pair, constant along an x-row
+struct yz_8x {
+    u32_8x YM, ZM;
+    f32_8x SY, SZ, NSY, NSZ;
+    f32_8x v, w;
+};
 
-    f32_4x X_4x = F32_4X(x, x+f, x+f+f, x+f+f+f);
-    f32_4x Y_4x = F32_4X(y);
-    f32_4x Z_4x = F32_4X(z);
+yz_8x setup_yz_8x(const f32 y, const f32 z)
+{
+    u32_8x mask = U32_8X(kMaxTableSizeMask);
+    f32_8x _1f_8x = F32_8X(1);
 
-    u32_4x XI_4x = U32_4X(vcvtq_u32_f32(X_4x.sse));
-    u32_4x YI_4x = U32_4X(vcvtq_u32_f32(Y_4x.sse));
-    u32_4x ZI_4x = U32_4X(vcvtq_u32_f32(Z_4x.sse));
+    f32_8x Y_8x = F32_8X(y);
+    f32_8x Z_8x = F32_8X(z);
 
-    u32_4x XM_4x = XI_4x & mask;
-    u32_4x YM_4x = YI_4x & mask;
-    u32_4x ZM_4x = ZI_4x & mask;
+    u32_8x YI_8x = _cvt_u32(Y_8x);
+    u32_8x ZI_8x = _cvt_u32(Z_8x);
+
+    yz_8x yz;
+    yz.YM = YI_8x & mask;
+    yz.ZM = ZI_8x & mask;
 
     // x - std::floor(x)
-    f32_4x SX_4x = X_4x - F32_4X(vcvtq_f32_u32(XI_4x.sse));
-    f32_4x SY_4x = Y_4x - F32_4X(vcvtq_f32_u32(YI_4x.sse));
-    f32_4x SZ_4x = Z_4x - F32_4X(vcvtq_f32_u32(ZI_4x.sse));
+    yz.SY = Y_8x - _cvt_f32(YI_8x);
+    yz.SZ = Z_8x - _cvt_f32(ZI_8x);
 
     // (x - std::floor(x)) - 1
-    f32_4x NSX_4x = SX_4x - _1f;
-    f32_4x NSY_4x = SY_4x - _1f;
-    f32_4x NSZ_4x = SZ_4x - _1f;
+    yz.NSY = yz.SY - _1f_8x;
+    yz.NSZ = yz.SZ - _1f_8x;
 
-    f32_4x u_4x = quintic_4x(SX_4x);
-    f32_4x v_4x = quintic_4x(SY_4x);
-    f32_4x w_4x = quintic_4x(SZ_4x);
+    yz.v = quintic_8x(yz.SY);
+    yz.w = quintic_8x(yz.SZ);
+    return yz;
+}
 
-    u32 A_0  = permutation[XM_4x.E[0]]   + Y_4x.E[0];
-    u32 AA_0 = permutation[A_0]          + Z_4x.E[0];
-    u32 AB_0 = permutation[A_0+1]        + Z_4x.E[0];
-    u32 B_0  = permutation[XM_4x.E[0]+1] + Y_4x.E[0];
-    u32 BA_0 = permutation[B_0]          + Z_4x.E[0];
-    u32 BB_0 = permutation[B_0+1]        + Z_4x.E[0];
-
-    u32 H0_0 = permutation[AA_0];
-    u32 H1_0 = permutation[BA_0];
-    u32 H2_0 = permutation[AB_0];
-    u32 H3_0 = permutation[BB_0];
-    u32 H4_0 = permutation[AA_0+1];
-    u32 H5_0 = permutation[BA_0+1];
-    u32 H6_0 = permutation[AB_0+1];
-    u32 H7_0 = permutation[BB_0+1];
-
-
-    u32 A_1  = permutation[XM_4x.E[1]]   + Y_4x.E[1];
-    u32 AA_1 = permutation[A_1]          + Z_4x.E[1];
-    u32 AB_1 = permutation[A_1+1]        + Z_4x.E[1];
-    u32 B_1  = permutation[XM_4x.E[1]+1] + Y_4x.E[1];
-    u32 BA_1 = permutation[B_1]          + Z_4x.E[1];
-    u32 BB_1 = permutation[B_1+1]        + Z_4x.E[1];
-
-    u32 H0_1 = permutation[AA_1];
-    u32 H1_1 = permutation[BA_1];
-    u32 H2_1 = permutation[AB_1];
-    u32 H3_1 = permutation[BB_1];
-    u32 H4_1 = permutation[AA_1+1];
-    u32 H5_1 = permutation[BA_1+1];
-    u32 H6_1 = permutation[AB_1+1];
-    u32 H7_1 = permutation[BB_1+1];
-
-
-    u32 A_2  = permutation[XM_4x.E[2]]   + Y_4x.E[2];
-    u32 AA_2 = permutation[A_2]          + Z_4x.E[2];
-    u32 AB_2 = permutation[A_2+1]        + Z_4x.E[2];
-    u32 B_2  = permutation[XM_4x.E[2]+1] + Y_4x.E[2];
-    u32 BA_2 = permutation[B_2]          + Z_4x.E[2];
-    u32 BB_2 = permutation[B_2+1]        + Z_4x.E[2];
-
-    u32 H0_2 = permutation[AA_2];
-    u32 H1_2 = permutation[BA_2];
-    u32 H2_2 = permutation[AB_2];
-    u32 H3_2 = permutation[BB_2];
-    u32 H4_2 = permutation[AA_2+1];
-    u32 H5_2 = permutation[BA_2+1];
-    u32 H6_2 = permutation[AB_2+1];
-    u32 H7_2 = permutation[BB_2+1];
-
-
-    u32 A_3  = permutation[XM_4x.E[3]]   + Y_4x.E[3];
-    u32 AA_3 = permutation[A_3]          + Z_4x.E[3];
-    u32 AB_3 = permutation[A_3+1]        + Z_4x.E[3];
-    u32 B_3  = permutation[XM_4x.E[3]+1] + Y_4x.E[3];
-    u32 BA_3 = permutation[B_3]          + Z_4x.E[3];
-    u32 BB_3 = permutation[B_3+1]        + Z_4x.E[3];
-
-    u32 H0_3 = permutation[AA_3];
-    u32 H1_3 = permutation[BA_3];
-    u32 H2_3 = permutation[AB_3];
-    u32 H3_3 = permutation[BB_3];
-    u32 H4_3 = permutation[AA_3+1];
-    u32 H5_3 = permutation[BA_3+1];
-    u32 H6_3 = permutation[AB_3+1];
-    u32 H7_3 = permutation[BB_3+1];
-
-
-    u32_4x H0 = U32_4X (H0_0, H0_1, H0_2, H0_3);
-    u32_4x H1 = U32_4X (H1_0, H1_1, H1_2, H1_3);
-    u32_4x H2 = U32_4X (H2_0, H2_1, H2_2, H2_3);
-    u32_4x H3 = U32_4X (H3_0, H3_1, H3_2, H3_3);
-    u32_4x H4 = U32_4X (H4_0, H4_1, H4_2, H4_3);
-    u32_4x H5 = U32_4X (H5_0, H5_1, H5_2, H5_3);
-    u32_4x H6 = U32_4X (H6_0, H6_1, H6_2, H6_3);
-    u32_4x H7 = U32_4X (H7_0, H7_1, H7_2, H7_3);
+f32_8x noise_8x(const f32_8x X_8x, const yz_8x &yz)
+{
+    u32_8x mask = U32_8X(kMaxTableSizeMask);
+    f32_8x _1f_8x = F32_8X(1);
+    u32_8x _1u_8x = U32_8X(1);
+
+    u32_8x XI_8x = _cvt_u32(X_8x);
+    u32_8x XM_8x = XI_8x & mask;
+
+    f32_8x SX_8x  = X_8x - _cvt_f32(XI_8x);
+    f32_8x NSX_8x = SX_8x - _1f_8x;
+    f32_8x u_8x   = quintic_8x(SX_8x);
+
+    // indices stay below 512, see permutation[]
+    u32_8x A  = _gather(permutation, XM_8x)          + yz.YM;
+    u32_8x AA = _gather(permutation, A)              + yz.ZM;
+    u32_8x AB = _gather(permutation, A + _1u_8x)     + yz.ZM;
+    u32_8x B  = _gather(permutation, XM_8x + _1u_8x) + yz.YM;
+    u32_8x BA = _gather(permutation, B)              + yz.ZM;
+    u32_8x BB = _gather(permutation, B + _1u_8x)     + yz.ZM;
+
+    u32_8x H0 = _gather(permutation, AA);
+    u32_8x H1 = _gather(permutation, BA);
+    u32_8x H2 = _gather(permutation, AB);
+    u32_8x H3 = _gather(permutation, BB);
+    u32_8x H4 = _gather(permutation, AA + _1u_8x);
+    u32_8x H5 = _gather(permutation, BA + _1u_8x);
+    u32_8x H6 = _gather(permutation, AB + _1u_8x);
+    u32_8x H7 = _gather(permutation, BB + _1u_8x);
+
+    f32_8x G0 = gradient_8x(H0, SX_8x,  yz.SY,  yz.SZ); 
+    f32_8x G1 = gradient_8x(H1, NSX_8x, yz.SY,  yz.SZ); 
+    f32_8x G2 = gradient_8x(H2, SX_8x,  yz.NSY, yz.SZ); 
+    f32_8x G3 = gradient_8x(H3, NSX_8x, yz.NSY, yz.SZ); 
+
+    f32_8x G4 = gradient_8x(H4, SX_8x,  yz.SY,  yz.NSZ); 
+    f32_8x G5 = gradient_8x(H5, NSX_8x, yz.SY,  yz.NSZ); 
+    f32_8x G6 = gradient_8x(H6, SX_8x,  yz.NSY, yz.NSZ); 
+    f32_8x G7 = gradient_8x(H7, NSX_8x, yz.NSY, yz.NSZ); 
+
+
+    f32_8x L0 = lerp_8x(u_8x, G0, G1);
+    f32_8x L1 = lerp_8x(u_8x, G2, G3);
+
+    f32_8x L2 = lerp_8x(u_8x, G4, G5);
+    f32_8x L3 = lerp_8x(u_8x, G6, G7);
+
+    f32_8x L5 = lerp_8x(yz.v, L0, L1);
+    f32_8x L6 = lerp_8x(yz.v, L2, L3);
+
+    return lerp_8x(yz.w, L5, L6);
+}
 
+// writes the first count lanes, count <= 8
+inline void store_partial (f32 *out, f32_8x A, const u32 count)
+{
+    if (count >= 8) {
+        _store(out, A);
+    } else {
+        for (u32 n = 0; n < count; n++)
+            out[n] = A.E[n];
+    }
+}
 
-    f32_4x G0 = gradient_4x(H0, SX_4x,  SY_4x,  SZ_4x); 
-    f32_4x G1 = gradient_4x(H1, NSX_4x, SY_4x,  SZ_4x); 
-    f32_4x G2 = gradient_4x(H2, SX_4x,  NSY_4x, SZ_4x); 
-    f32_4x G3 = gradient_4x(H3, NSX_4x, NSY_4x, SZ_4x); 
+void perlinNoiseSIMD_8x(const f32 x, const f32 y, const f32 z, const f32 f, f32 *data) 
+{
+    f32_8x X_8x = F32_8X(x, x+f, x+2*f, x+3*f, x+4*f, x+5*f, x+6*f, x+7*f);
+    _store(data, noise_8x(X_8x, setup_yz_8x(y, z)));
+}
 
-    f32_4x G4 = gradient_4x(H4, SX_4x,  SY_4x,  NSZ_4x); 
-    f32_4x G5 = gradient_4x(H5, NSX_4x, SY_4x,  NSZ_4x); 
-    f32_4x G6 = gradient_4x(H6, SX_4x,  NSY_4x, NSZ_4x); 
-    f32_4x G7 = gradient_4x(H7, NSX_4x, NSY_4x, NSZ_4x); 
+// count samples at x, x+f, x+2f, ... in one call, 8 lanes at a time
+void perlinNoiseRow(const f32 x, const f32 y, const f32 z, const f32 f, const u32 count, f32 *data)
+{
+    yz_8x yz = setup_yz_8x(y, z);
 
+    for (u32 i=0; i<count; i+=8) {
+        f32 xs = x + i*f;
+        f32_8x X_8x = F32_8X(xs, xs+f, xs+2*f, xs+3*f, xs+4*f, xs+5*f, xs+6*f, xs+7*f);
+        store_partial(data + i, noise_8x(X_8x, yz), count - i);
+    }
+}
 
-    f32_4x L0 = lerp_4x(u_4x, G0, G1);
-    f32_4x L1 = lerp_4x(u_4x, G2, G3);
 
-    f32_4x L2 = lerp_4x(u_4x, G4, G5);
-    f32_4x L3 = lerp_4x(u_4x, G6, G7);
+// gradient() as a vector: every hash picks two axes with a +-1 sign
+void gradient_vec (u32 hash, f32 g[3]) {
 
-    f32_4x L5 = lerp_4x(v_4x, L0, L1);
-    f32_4x L6 = lerp_4x(v_4x, L2, L3);
+    u32 h = hash & 15;
+    f32 uSign = (h & 1) ? -1.0f : 1.0f;
+    f32 vSign = (h & 2) ? -1.0f : 1.0f;
+
+    g[0] = g[1] = g[2] = 0;
+    g[h < 8 ? 0 : 1] += uSign;
+    g[h < 4 ? 1 : (h == 12 || h == 14) ? 0 : 2] += vSign;
+}
+
+// the 8 corner gradients of lattice cell (X, Y, Z), in G0..G7 order
+void cell_gradients (u32 X, u32 Y, u32 Z, f32 g[8][3]) {
+
+    X &= kMaxTableSizeMask;
+    Y &= kMaxTableSizeMask;
+    Z &= kMaxTableSizeMask;
+
+    u32 A  = permutation[X]   + Y;
+    u32 AA = permutation[A]   + Z;
+    u32 AB = permutation[A+1] + Z;
+    u32 B  = permutation[X+1] + Y;
+    u32 BA = permutation[B]   + Z;
+    u32 BB = permutation[B+1] + Z;
+
+    gradient_vec(permutation[AA],   g[0]);
+    gradient_vec(permutation[BA],   g[1]);
+    gradient_vec(permutation[AB],   g[2]);
+    gradient_vec(permutation[BB],   g[3]);
+    gradient_vec(permutation[AA+1], g[4]);
+    gradient_vec(permutation[BA+1], g[5]);
+    gradient_vec(permutation[AB+1], g[6]);
+    gradient_vec(permutation[BB+1], g[7]);
+}
+
+// same truncation as _cvt_u32, coordinates are expected to be positive
+inline u32 lattice (f32 c) { return c > 0 ? (u32)c : 0; }
+
+// samples per x tile, keeps the per-axis tables on the stack
+static const u32 kVolumeTile = 64;
+
+// above this spacing a cell holds too few samples to pay for its setup and
+// the volume kernels gather hashes per lane instead (noise_8x)
+static const f32 kVolumeMaxCachedSpacing = 0.25f;
+
+// one noise frequency walking an x tile of a volume.
+//
+// inside one lattice cell the 8 corner gradients are fixed, and along an
+// x-row y/z (and their fades) are too, so the trilinear blend collapses to
+//     n(sx) = K0 + K1*sx + u(sx) * (K2 + K3*sx)
+// with 4 constants per row and cell. corner hashes are only recomputed when
+// the row crosses into a new y/z cell.
+struct volume_octave {
+    f32 SX[kVolumeTile], U[kVolumeTile], XC[kVolumeTile];   // per sample: fraction, fade, cell
+    u32 first_cx, cells;
+    u32 cached_cy, cached_cz;
+    f32 G[kVolumeTile + 1][8][3];
+    f32 K0[kVolumeTile + 1], K1[kVolumeTile + 1], K2[kVolumeTile + 1], K3[kVolumeTile + 1];
+};
+
+// samples from x0 on that fit one tile, so that f > 1 never needs more
+// than kVolumeTile + 1 cells
+u32 volume_tile_length (const f32 x, const f32 f, const u32 x0, const u32 nx)
+{
+    u32 first_cx = lattice(x + x0*f);
+    u32 tx = 0;
+    while (tx < kVolumeTile && x0 + tx < nx && lattice(x + (x0 + tx)*f) - first_cx <= kVolumeTile)
+        tx++;
+    return tx;
+}
+
+void volume_setup_tile (volume_octave &o, const f32 x, const f32 f, const u32 x0, const u32 tx)
+{
+    o.first_cx = lattice(x + x0*f);
+    for (u32 i = 0; i < tx; i++) {
+        f32 c = x + (x0 + i)*f;
+        u32 ci = lattice(c);
+        o.SX[i] = c - (f32)ci;
+        o.U[i]  = quintic(o.SX[i]);
+        o.XC[i] = (f32)(ci - o.first_cx);
+    }
+    // pad to whole 8-lane steps with the last sample
+    for (u32 i = tx; i < kVolumeTile; i++) {
+        o.SX[i] = o.SX[tx-1];
+        o.U[i]  = o.U[tx-1];
+        o.XC[i] = o.XC[tx-1];
+    }
+    o.cells = (u32)o.XC[tx-1] + 1;
+    o.cached_cy = o.cached_cz = ~0u;
+}
+
+void volume_setup_row (volume_octave &o, const f32 cy, const f32 cz)
+{
+    u32 CY = lattice(cy);
+    u32 CZ = lattice(cz);
+    f32 sy = cy - (f32)CY;
+    f32 sz = cz - (f32)CZ;
+    f32 v  = quintic(sy);
+    f32 w  = quintic(sz);
+
+    if (CY != o.cached_cy || CZ != o.cached_cz) {
+        for (u32 c = 0; c < o.cells; c++)
+            cell_gradients(o.first_cx + c, CY, CZ, o.G[c]);
+        o.cached_cy = CY;
+        o.cached_cz = CZ;
+    }
 
-    f32_4x result = lerp_4x(w_4x, L5, L6);
+    // pair p blends corners 2p (x side 0) and 2p+1 (x side 1),
+    // its y/z side is (p & 1, p >> 1)
+    for (u32 c = 0; c < o.cells; c++) {
+        f32 K0 = 0, K1 = 0, K2 = 0, K3 = 0;
+        for (u32 p = 0; p < 4; p++) {
+            f32 oy = (f32)(p & 1);
+            f32 oz = (f32)(p >> 1);
+            f32 a  = (oy ? v : 1-v) * (oz ? w : 1-w);
+
+            const f32* g0 = o.G[c][2*p];
+            const f32* g1 = o.G[c][2*p+1];
+            f32 c0 = g0[1]*(sy-oy) + g0[2]*(sz-oz);
+            f32 c1 = g1[1]*(sy-oy) + g1[2]*(sz-oz);
+
+            K0 += a * c0;
+            K1 += a * g0[0];
+            K2 += a * (c1 - g1[0] - c0);
+            K3 += a * (g1[0] - g0[0]);
+        }
+        o.K0[c] = K0; o.K1[c] = K1; o.K2[c] = K2; o.K3[c] = K3;
+    }
+}
+
+// samples i..i+7 of the current row
+inline f32_8x volume_eval_8x (const volume_octave &o, const u32 i)
+{
+    u32 lo = (u32)o.XC[i];
+    u32 hi = (u32)o.XC[i+7];
+
+    f32_8x K0, K1, K2, K3;
+    if (hi == lo) {
+        K0 = F32_8X(o.K0[lo]);
+        K1 = F32_8X(o.K1[lo]);
+        K2 = F32_8X(o.K2[lo]);
+        K3 = F32_8X(o.K3[lo]);
+    } else if (hi == lo + 1) {
+        // one cell boundary inside these 8 lanes
+        u32_8x next = _load_8x(o.XC + i) > F32_8X((f32)lo + 0.5f);
+        K0 = _select(next, F32_8X(o.K0[hi]), F32_8X(o.K0[lo]));
+        K1 = _select(next, F32_8X(o.K1[hi]), F32_8X(o.K1[lo]));
+        K2 = _select(next, F32_8X(o.K2[hi]), F32_8X(o.K2[lo]));
+        K3 = _select(next, F32_8X(o.K3[hi]), F32_8X(o.K3[lo]));
+    } else {
+        u32_8x cell = _cvt_u32(_load_8x(o.XC + i));
+        K0 = _gather(o.K0, cell);
+        K1 = _gather(o.K1, cell);
+        K2 = _gather(o.K2, cell);
+        K3 = _gather(o.K3, cell);
+    }
 
-    data[0] = result.E[0];
-    data[1] = result.E[1];
-    data[2] = result.E[2];
-    data[3] = result.E[3];
+    f32_8x SX_8x = _load_8x(o.SX + i);
+    f32_8x u_8x  = _load_8x(o.U + i);
+    return K0 + K1*SX_8x + u_8x*(K2 + K3*SX_8x);
 }
 
+// where the volume walkers hand their results: count (<= 8 used) samples of
+// row (j, k) starting at sample i
+struct store_sink {
+    f32* data;
+    u32 nx, ny;
+
+    void operator() (const u32 i, const u32 j, const u32 k, const f32_8x value, const u32 count) {
+        store_partial(data + (k*ny + j)*nx + i, value, count);
+    }
+};
+
+// bit i of rows[k*ny + j] set where the noise >= threshold, rows start zeroed
+struct solidity_sink {
+    uint64_t* rows;
+    u32 ny;
+    f32 threshold;
+
+    void operator() (const u32 i, const u32 j, const u32 k, const f32_8x value, const u32 count) {
+        u32 below = _movemask(value < F32_8X(threshold));
+        u32 lanes = count < 8 ? (1u << count) - 1 : 0xFF;
+        rows[k*ny + j] |= (uint64_t)(~below & lanes) << i;
+    }
+};
+
+// noise_volume for spacings too wide to cache cells, hashes gathered per lane
+template <typename Sink>
+void noise_volume_gather(const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, Sink sink)
+{
+    f32_8x lane = F32_8X(0, 1, 2, 3, 4, 5, 6, 7);
+    for (u32 k = 0; k < nz; k++) {
+        for (u32 j = 0; j < ny; j++) {
+            yz_8x yz = setup_yz_8x(y + j*f, z + k*f);
+            for (u32 i = 0; i < nx; i += 8)
+                sink(i, j, k, noise_8x(F32_8X(x + i*f) + lane*F32_8X(f), yz), nx - i);
+        }
+    }
+}
+
+// the noise at (x + i*f, y + j*f, z + k*f) for the whole volume, row by row
+template <typename Sink>
+void noise_volume(const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, Sink sink)
+{
+    if (f > kVolumeMaxCachedSpacing) {
+        noise_volume_gather(x, y, z, nx, ny, nz, f, sink);
+        return;
+    }
+
+    volume_octave o;
+
+    for (u32 x0 = 0, tx = 0; x0 < nx; x0 += tx) {
+
+        tx = volume_tile_length(x, f, x0, nx);
+        volume_setup_tile(o, x, f, x0, tx);
+
+        for (u32 k = 0; k < nz; k++) {
+            for (u32 j = 0; j < ny; j++) {
+
+                volume_setup_row(o, y + j*f, z + k*f);
+
+                for (u32 i = 0; i < tx; i += 8)
+                    sink(x0 + i, j, k, volume_eval_8x(o, i), tx - i);
+            }
+        }
+    }
+}
+
+// fills data[(k*ny + j)*nx + i] with the noise at (x + i*f, y + j*f, z + k*f)
+void perlinNoiseVolume(const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, f32 *data)
+{
+    store_sink sink = { data, nx, ny };
+    noise_volume(x, y, z, nx, ny, nz, f, sink);
+}
+
+static const u32 kMaxOctaves = 8;
+
+// |A| per lane
+inline f32_8x abs_8x (const f32_8x A)
+{
+    return _select(A < F32_8X(0.0f), F32_8X(0.0f) - A, A);
+}
+
+// fBm / ridged noise, all octaves of a lane batch accumulated in registers
+// before the single store. low octaves keep their own cell cached tile and
+// row state (the x tile is as long as the highest of them allows), the high
+// ones gather per lane. output is in [-1, 1]
+void perlinFractalVolume(const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, const perlin_fractal &fractal, f32 *data)
+{
+    u32 octaves = fractal.octaves < 1 ? 1 : fractal.octaves > kMaxOctaves ? kMaxOctaves : fractal.octaves;
+
+    volume_octave o[kMaxOctaves];
+    yz_8x yz[kMaxOctaves];
+    f32 OX[kMaxOctaves], OY[kMaxOctaves], OZ[kMaxOctaves], OF[kMaxOctaves], amplitude[kMaxOctaves];
+    bool cached[kMaxOctaves];
+
+    f32 frequency = 1, amp = 1, amp_sum = 0;
+    for (u32 n = 0; n < octaves; n++) {
+        // shift each octave off the others' lattice, they'd all be 0 on the same points otherwise
+        f32 offset = n * 19.19f;
+        OX[n] = x * frequency + offset;
+        OY[n] = y * frequency + offset;
+        OZ[n] = z * frequency + offset;
+        OF[n] = f * frequency;
+        cached[n] = OF[n] <= kVolumeMaxCachedSpacing;
+        amplitude[n] = amp;
+        amp_sum += amp;
+        frequency *= fractal.lacunarity;
+        amp *= fractal.gain;
+    }
+
+    bool ridged = fractal.type == PERLIN_RIDGED;
+    // fBm sums to [-amp_sum, amp_sum], ridged octaves are (1-|n|)^2 in [0, 1]
+    f32_8x scale = F32_8X(ridged ? 2.0f / amp_sum : 1.0f / amp_sum);
+    f32_8x bias  = F32_8X(ridged ? -1.0f : 0.0f);
+    f32_8x one   = F32_8X(1.0f);
+    f32_8x lane  = F32_8X(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (u32 x0 = 0, tx = 0; x0 < nx; x0 += tx) {
+
+        tx = kVolumeTile;
+        if (nx - x0 < tx) tx = nx - x0;
+        for (u32 n = 0; n < octaves; n++) {
+            if (!cached[n]) continue;
+            u32 t = volume_tile_length(OX[n], OF[n], x0, nx);
+            tx = t < tx ? t : tx;
+        }
+        for (u32 n = 0; n < octaves; n++)
+            if (cached[n]) volume_setup_tile(o[n], OX[n], OF[n], x0, tx);
+
+        for (u32 k = 0; k < nz; k++) {
+            for (u32 j = 0; j < ny; j++) {
+
+                for (u32 n = 0; n < octaves; n++) {
+                    if (cached[n])
+                        volume_setup_row(o[n], OY[n] + j*OF[n], OZ[n] + k*OF[n]);
+                    else
+                        yz[n] = setup_yz_8x(OY[n] + j*OF[n], OZ[n] + k*OF[n]);
+                }
+
+                f32* out = data + (k*ny + j)*nx + x0;
+                for (u32 i = 0; i < tx; i += 8) {
+
+                    f32_8x sum = F32_8X(0.0f);
+                    for (u32 n = 0; n < octaves; n++) {
+                        f32_8x value = cached[n] ? volume_eval_8x(o[n], i)
+                                                 : noise_8x(F32_8X(OX[n] + (x0 + i)*OF[n]) + lane*F32_8X(OF[n]), yz[n]);
+                        if (ridged) {
+                            value = one - abs_8x(value);
+                            value = value * value;
+                        }
+                        sum = sum + F32_8X(amplitude[n]) * value;
+                    }
+
+                    store_partial(out + i, sum * scale + bias, tx - i);
+                }
+            }
+        }
+    }
+}
+
+// scratch limits for the coarse path, bigger volumes fall back to full rate
+static const u32 kCoarsePlane    = 1024;   // coarse samples per z plane
+static const u32 kUpsampledPlane = 8192;   // coarse rows * nx
+
+// one coarse z plane, upsampled along x into cny rows of nx samples
+void coarse_plane (const f32 x, const f32 y, const f32 z, const u32 nx, const u32 cnx, const u32 cny, const u32 step, const f32 f, f32 *coarse, f32 *plane)
+{
+    perlinNoiseVolume(x, y, z, cnx, cny, 1, step * f, coarse);
+
+    f32 inv_step = 1.0f / step;
+    for (u32 j = 0; j < cny; j++) {
+        const f32* c = coarse + j*cnx;
+        f32* out = plane + j*nx;
+        for (u32 ci = 0, i = 0; i < nx; ci++) {
+            out[i++] = c[ci];
+            if (i == nx) break;
+            f32 d = c[ci+1] - c[ci];
+            for (u32 s = 1; s < step && i < nx; s++)
+                out[i++] = c[ci] + (s * inv_step) * d;
+        }
+    }
+}
+
+// noise only every `step` samples, trilinearly interpolated in between. the
+// interpolation error is at most (step*f)^2 / 8 * (|n_xx| + |n_yy| + |n_zz|),
+// see perlin_coarse_step.
+template <typename Sink>
+void coarse_volume(const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, const u32 step, Sink sink)
+{
+    u32 cnx = (nx - 1 + step - 1) / step + 1;
+    u32 cny = (ny - 1 + step - 1) / step + 1;
+
+    if (step <= 1 || nx == 0 || ny == 0 || nz == 0 || cnx * cny > kCoarsePlane || cny * nx > kUpsampledPlane) {
+        noise_volume(x, y, z, nx, ny, nz, f, sink);
+        return;
+    }
+
+    f32 coarse[kCoarsePlane];
+    // + 8 so the last 8-lane load of a plane stays inside
+    f32 planes[2][kUpsampledPlane + 8];
+    f32 inv_step = 1.0f / step;
+
+    f32* P0 = planes[0];
+    f32* P1 = planes[1];
+    coarse_plane(x, y, z, nx, cnx, cny, step, f, coarse, P0);
+
+    for (u32 cz = 0; cz * step < nz; cz++) {
+
+        coarse_plane(x, y, z + (cz+1)*step*f, nx, cnx, cny, step, f, coarse, P1);
+
+        u32 k_end = (cz+1)*step < nz ? (cz+1)*step : nz;
+        for (u32 k = cz*step; k < k_end; k++) {
+
+            f32_8x w = F32_8X((k - cz*step) * inv_step);
+
+            for (u32 j = 0; j < ny; j++) {
+
+                u32 cy = j / step;
+                f32_8x v = F32_8X((j - cy*step) * inv_step);
+                u32 cy1 = cy + (j > cy*step);
+
+                const f32* a0 = P0 + cy*nx;
+                const f32* a1 = P0 + cy1*nx;
+                const f32* b0 = P1 + cy*nx;
+                const f32* b1 = P1 + cy1*nx;
+
+                for (u32 i = 0; i < nx; i += 8) {
+                    f32_8x lo = lerp_8x(v, _load_8x(a0 + i), _load_8x(a1 + i));
+                    f32_8x hi = lerp_8x(v, _load_8x(b0 + i), _load_8x(b1 + i));
+                    sink(i, j, k, lerp_8x(w, lo, hi), nx - i);
+                }
+            }
+        }
+
+        f32* t = P0; P0 = P1; P1 = t;
+    }
+}
+
+// like perlinNoiseVolume, interpolated from a coarse grid, see coarse_volume
+void perlinNoiseVolumeCoarse(const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, const u32 step, f32 *data)
+{
+    store_sink sink = { data, nx, ny };
+    coarse_volume(x, y, z, nx, ny, nz, f, step, sink);
+}
+
+// the volume as one bit per sample (nx <= 64): bit i of rows[k*ny + j] is
+// set where the noise is >= threshold. step > 1 goes through coarse_volume
+void perlinSolidityVolume(const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, const u32 step, const f32 threshold, uint64_t *rows)
+{
+    for (u32 r = 0; r < ny*nz; r++)
+        rows[r] = 0;
+
+    solidity_sink sink = { rows, ny, threshold };
+    coarse_volume(x, y, z, nx < 64 ? nx : 64, ny, nz, f, step, sink);
+}
 
 void perlinNoise_8x(f32 x, f32 y, f32 z, f32 *data, f32 f) 
 {
@@ -578,3 +977,28 @@ void generateNoise (u32 startX, u32 startY, u32 startZ, u32 width, u32 height, f
         } 
     } 
 }
+
+extern const perlin_kernels kernels = {
+#if defined(PERLIN_SIMD_AVX512)
+    "avx512",
+#elif defined(PERLIN_SIMD_AVX2)
+    "avx2",
+#elif defined(PERLIN_SIMD_SSE41)
+    "sse41",
+#elif defined(PERLIN_SIMD_NEON)
+    "neon",
+#else
+    "scalar",
+#endif
+    perlinNoiseSIMD_4x,
+    perlinNoiseSIMD_4x_f32,
+    perlinNoiseSIMD_8x,
+    perlinNoise_8x,
+    perlinNoiseRow,
+    perlinNoiseVolume,
+    perlinNoiseVolumeCoarse,
+    perlinFractalVolume,
+    perlinSolidityVolume,
+};
+
+} // namespace PERLIN_NAMESPACE
@@ -0,0 +1,62 @@
+#pragma once
+
+// public side of the noise kernels. perlin.cpp is compiled once per ISA
+// (see CMakeLists.txt), each copy in its own namespace, and
+// perlin_dispatch.cpp picks the widest one the running cpu supports.
+
+#include <stdint.h>
+
+typedef float f32;
+typedef uint32_t u32;
+typedef int32_t s32;
+
+enum perlin_fractal_type {
+    PERLIN_FBM,       // sum of octaves
+    PERLIN_RIDGED,    // sum of (1 - |octave|)^2, sharp crests
+};
+
+// octave n is sampled at frequency lacunarity^n with weight gain^n
+struct perlin_fractal {
+    u32 octaves = 4;          // 1..8
+    f32 lacunarity = 2.0f;
+    f32 gain = 0.5f;
+    perlin_fractal_type type = PERLIN_FBM;
+};
+
+struct perlin_kernels {
+    const char* name;
+    // 4 samples quantized to [0,255]: floor((n + 1) * 127.5)
+    void (*perlinNoiseSIMD_4x) (const f32 x, const f32 y, const f32 z, const f32 f, uint8_t *data);
+    // the same 4 samples as [-1,1] density, no quantization
+    void (*perlinNoiseSIMD_4x_f32) (const f32 x, const f32 y, const f32 z, const f32 f, f32 *data);
+    void (*perlinNoiseSIMD_8x) (const f32 x, const f32 y, const f32 z, const f32 f, f32 *data);
+    void (*perlinNoise_8x)     (f32 x, f32 y, f32 z, f32 *data, f32 f);
+    // a whole x-run (x, x+f, ... count samples) of [-1,1] noise per call
+    void (*perlinNoiseRow)     (const f32 x, const f32 y, const f32 z, const f32 f, const u32 count, f32 *data);
+    // nx*ny*nz samples starting at (x, y, z), spacing f, x fastest:
+    // data[(k*ny + j)*nx + i]. corner gradients are shared per lattice cell
+    void (*perlinNoiseVolume)  (const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, f32 *data);
+    // same layout, noise only every `step` samples per axis and trilinearly
+    // interpolated in between. pick step with perlin_coarse_step
+    void (*perlinNoiseVolumeCoarse) (const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, const u32 step, f32 *data);
+    // every octave of a lane batch in one pass, same layout as perlinNoiseVolume, [-1,1]
+    void (*perlinFractalVolume) (const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, const perlin_fractal &fractal, f32 *data);
+    // one bit per sample, nx <= 64: bit i of rows[k*ny + j] set where noise >= threshold.
+    // step > 1 samples coarse like perlinNoiseVolumeCoarse
+    void (*perlinSolidityVolume) (const f32 x, const f32 y, const f32 z, const u32 nx, const u32 ny, const u32 nz, const f32 f, const u32 step, const f32 threshold, uint64_t *rows);
+};
+
+// resolved once (cpuid) on first call, then cached.
+// PERLIN_ISA=scalar|sse41|avx2|avx512|neon in the environment forces a
+// specific variant, as long as the cpu can run it.
+const perlin_kernels& perlin_get_kernels ();
+
+// every variant built in that the running cpu can execute, widest first
+// (scalar is always last). returns how many were written to out
+#define PERLIN_MAX_KERNELS 5
+int perlin_supported_kernels (const perlin_kernels* out[PERLIN_MAX_KERNELS]);
+
+// largest power of two step (up to max_step) for perlinNoiseVolumeCoarse at
+// sample spacing f whose worst case interpolation error stays <= max_error.
+// 1 means evaluate at full rate.
+u32 perlin_coarse_step (f32 f, f32 max_error, u32 max_step = 8);
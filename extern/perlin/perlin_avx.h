@@ -1,254 +1,316 @@
-// #include <cstdio> 
-// #include <random> 
-// #include <functional> 
-// #include <iostream> 
-// #include <fstream> 
-// #include <cmath> 
-// #include <vector> // Added for std::vector
-// #include <stdint.h>
-// #include <filesystem>
-// #include <arm_neon.h>
-// #define STB_IMAGE_WRITE_IMPLEMENTATION
-// #include "../../include/stb_image_write.h"
-
-// typedef float f32;
-// typedef uint32_t u32;
-// typedef int32_t s32;
-// static const unsigned kMaxTableSize = 256; 
-// static const unsigned kMaxTableSizeMask = kMaxTableSize - 1;
-
-// // https://stackoverflow.com/questions/13772567/how-to-get-the-cpu-cycle-count-in-x86-64-from-c
-// #ifdef _WIN32
-
-//     #include <smmintrin.h>
-//     #include <emmintrin.h>
-//     #include <xmmintrin.h>
-//     #include <intrin.h>
-//     uint64_t read_cycle_counter(){
-//         // Serialize with CPUID
-//         int cpuInfo[4];
-//         __cpuid(cpuInfo, 0);
-//         return __rdtsc();
-//     }
-
-//     union f32_8x
-//     {
-//         __m128 sse;
-//         f32 E[4];
-//     };
-
-//     union u32_8x {
-//         __m128i sse;
-//         u32 E[4];
-//     };
-
-//     f32_8x F32_8X(f32 A, f32 B, f32 C, f32 D) {
-//         // set backwards
-//         f32_8x result = {{ _mm256_set_ps(D,C,B,A) }};
-//         return result;
-//     }
-
-//     f32_8x F32_8X(f32 A) {
-//         // set backwards
-//         f32_8x result = {{ _mm256_set_ps1(A) }};
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator+ (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = {{ _mm256_add_ps(A.sse, B.sse) }};
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator- (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = {{ _mm256_sub_ps(A.sse, B.sse) }};
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator* (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = {{ _mm256_mul_ps(A.sse, B.sse) }};
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator& (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = {{ _mm256_and_ps(A.sse, B.sse) }};
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator| (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = {{ _mm256_or_ps(A.sse, B.sse) }};
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator==(f32_8x A, f32_8x B)
-//     {
-//     f32_8x result = {{ _mm256_cmpeq_ps(A.sse, B.sse) }};
-//     return result;
-//     }
-
-//     inline f32_8x
-//     operator>(f32_8x A, f32_8x B)
-//     {
-//     f32_8x result = {{ _mm256_cmpgt_ps(A.sse, B.sse) }};
-//     return result;
-//     }
-
-//     inline f32_8x
-//     operator<(f32_8x A, f32_8x B)
-//     {
-//     f32_8x result = {{ _mm256_cmplt_ps(A.sse, B.sse) }};
-//     return result;
-//     }
-
-//     inline
-//     f32_8x _select(u32_8x mask, f32_8x A, f32_8x B) {
-//         f32_8x result;
-//         result.sse = _mm256_blendv_ps(B.sse, A.sse, mask.sse);;
-//         return result;
-//     }
-
-// #else
-
-//     #include <mach/mach_time.h>
-//     static inline uint64_t read_cycle_counter() {
-//         return mach_absolute_time();  // Use macOS-specific high-resolution timer
-//     }
-
-//     // different representations of the same thing
-//     union f32_8x
-//     {
-//         float32x4_t sse;
-//         f32 E[4];
-//     };
-
-//     union u32_8x {
-//         uint32x4_t sse;
-//         u32 E[4];
-//     };
-
-//     f32_8x F32_8X(f32 A, f32 B, f32 C, f32 D) {
-//         // no need to set backwards
-//         f32_8x result = { A, B, C, D };
-//         return result;
-//     }
-
-//     f32_8x F32_8X(f32 A) {
-//         // set backwards
-//         f32_8x result = { vdupq_n_f32(A) };
-//         return result;
-//     }
-
-//     f32_8x F32_8X(float32x4_t A) {
-
-//         f32_8x res;
-//         res.sse = A;
-//         return res;
-//     }
-
-//     u32_8x U32_8X(u32 A, u32 B, u32 C, u32 D) {
-//         // no need to set backwards
-//         u32_8x result = { A, B, C, D };
-//         return result;
-//     }
-
-//     u32_8x U32_8X(u32 A) {
-//         // set backwards
-//         u32_8x result = { vdupq_n_u32(A) };
-//         return result;
-//     }
-
-//     u32_8x U32_8X(uint32x4_t A) {
-
-//         u32_8x res;
-//         res.sse = A;
-//         return res;
-//     }
-
-//     inline f32_8x
-//     operator+ (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = { vaddq_f32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator- (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = { vsubq_f32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator* (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = { vmulq_f32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline f32_8x
-//     operator/ (f32_8x A, f32_8x B)
-//     {
-//         f32_8x result = { vdivq_f32(A.sse, B.sse) };
-//         return result;
-//     } 
-
-//     inline u32_8x
-//     operator* (u32_8x A, u32_8x B)
-//     {
-//         u32_8x result = { vmulq_u32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline u32_8x
-//     operator& (u32_8x A, u32_8x B)
-//     {
-//         u32_8x result = { vandq_u32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline u32_8x
-//     operator| (u32_8x A, u32_8x B)
-//     {
-//         u32_8x result = { vorrq_u32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline u32_8x
-//     operator==(u32_8x A, u32_8x B)
-//     {
-//         u32_8x result = { vceqq_f32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline u32_8x
-//     operator>(u32_8x A, u32_8x B)
-//     {
-//         u32_8x result = { vcgtq_f32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline u32_8x
-//     operator<(u32_8x A, u32_8x B)
-//     {
-//         u32_8x result = { vcltq_f32(A.sse, B.sse) };
-//         return result;
-//     }
-
-//     inline f32_8x
-//     _select(u32_8x mask, f32_8x A, f32_8x B) {
-//         f32_8x result;
-//         result.sse = vbslq_f32(mask.sse, A.sse, B.sse);;
-//         return result;
-//     }
-
-// #endif
\ No newline at end of file
+#pragma once
+
+#include "perlin_sse.h"
+
+// 8 lanes. real registers with -mavx2, otherwise two f32_4x halves so the
+// 8x kernels still run (and vectorize) on whatever 4x backend was picked.
+#if !defined(PERLIN_FORCE_SCALAR) && defined(__AVX2__)
+    #define PERLIN_SIMD_AVX2 1
+    #include <immintrin.h>
+    #if defined(__AVX512F__) && defined(__AVX512VL__)
+        // same 8 lane types, the compiler just gets EVEX encodings and 32 registers
+        #define PERLIN_SIMD_AVX512 1
+    #endif
+#endif
+
+namespace PERLIN_NAMESPACE {
+
+#if defined(PERLIN_SIMD_AVX2)
+
+    union f32_8x
+    {
+        __m256 sse;
+        f32 E[8];
+    };
+
+    union u32_8x {
+        __m256i sse;
+        u32 E[8];
+    };
+
+    inline f32_8x F32_8X(f32 A, f32 B, f32 C, f32 D, f32 E, f32 F, f32 G, f32 H) {
+        // set backwards
+        f32_8x result = {{ _mm256_set_ps(H,G,F,E,D,C,B,A) }};
+        return result;
+    }
+
+    inline f32_8x F32_8X(f32 A) {
+        f32_8x result = {{ _mm256_set1_ps(A) }};
+        return result;
+    }
+
+    inline u32_8x U32_8X(u32 A, u32 B, u32 C, u32 D, u32 E, u32 F, u32 G, u32 H) {
+        // set backwards
+        u32_8x result = {{ _mm256_set_epi32(H,G,F,E,D,C,B,A) }};
+        return result;
+    }
+
+    inline u32_8x U32_8X(u32 A) {
+        u32_8x result = {{ _mm256_set1_epi32(A) }};
+        return result;
+    }
+
+    inline f32_8x
+    operator+ (f32_8x A, f32_8x B)
+    {
+        f32_8x result = {{ _mm256_add_ps(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline f32_8x
+    operator- (f32_8x A, f32_8x B)
+    {
+        f32_8x result = {{ _mm256_sub_ps(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline f32_8x
+    operator* (f32_8x A, f32_8x B)
+    {
+        f32_8x result = {{ _mm256_mul_ps(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline f32_8x
+    operator/ (f32_8x A, f32_8x B)
+    {
+        f32_8x result = {{ _mm256_div_ps(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator+ (u32_8x A, u32_8x B)
+    {
+        u32_8x result = {{ _mm256_add_epi32(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator* (u32_8x A, u32_8x B)
+    {
+        u32_8x result = {{ _mm256_mullo_epi32(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator& (u32_8x A, u32_8x B)
+    {
+        u32_8x result = {{ _mm256_and_si256(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator| (u32_8x A, u32_8x B)
+    {
+        u32_8x result = {{ _mm256_or_si256(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator==(u32_8x A, u32_8x B)
+    {
+        u32_8x result = {{ _mm256_cmpeq_epi32(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator>(u32_8x A, u32_8x B)
+    {
+        u32_8x result = {{ _mm256_cmpgt_epi32(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator<(u32_8x A, u32_8x B)
+    {
+        u32_8x result = {{ _mm256_cmpgt_epi32(B.sse, A.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator>(f32_8x A, f32_8x B)
+    {
+        u32_8x result = {{ _mm256_castps_si256(_mm256_cmp_ps(A.sse, B.sse, _CMP_GT_OQ)) }};
+        return result;
+    }
+
+    inline u32_8x
+    operator<(f32_8x A, f32_8x B)
+    {
+        u32_8x result = {{ _mm256_castps_si256(_mm256_cmp_ps(A.sse, B.sse, _CMP_LT_OQ)) }};
+        return result;
+    }
+
+    inline f32_8x
+    _select(u32_8x mask, f32_8x A, f32_8x B) {
+        f32_8x result;
+        result.sse = _mm256_blendv_ps(B.sse, A.sse, _mm256_castsi256_ps(mask.sse));
+        return result;
+    }
+
+    inline u32_8x
+    _cvt_u32(f32_8x A) {
+        u32_8x result = {{ _mm256_cvttps_epi32(_mm256_max_ps(A.sse, _mm256_setzero_ps())) }};
+        return result;
+    }
+
+    inline f32_8x
+    _cvt_f32(u32_8x A) {
+        f32_8x result = {{ _mm256_cvtepi32_ps(A.sse) }};
+        return result;
+    }
+
+    inline u32_8x
+    _gather(const u32* table, u32_8x index) {
+        u32_8x result = {{ _mm256_i32gather_epi32((const int*)table, index.sse, 4) }};
+        return result;
+    }
+
+    inline f32_8x
+    _gather(const f32* table, u32_8x index) {
+        f32_8x result = {{ _mm256_i32gather_ps(table, index.sse, 4) }};
+        return result;
+    }
+
+    // sign bit of every lane, lane 0 in bit 0
+    inline u32
+    _movemask(u32_8x A) {
+        return _mm256_movemask_ps(_mm256_castsi256_ps(A.sse));
+    }
+
+    inline f32_8x
+    _load_8x(const f32* p) {
+        f32_8x result = {{ _mm256_loadu_ps(p) }};
+        return result;
+    }
+
+    inline void
+    _store(f32* p, f32_8x A) {
+        _mm256_storeu_ps(p, A.sse);
+    }
+
+#else
+
+    union f32_8x
+    {
+        f32_4x H[2];
+        f32 E[8];
+    };
+
+    union u32_8x {
+        u32_4x H[2];
+        u32 E[8];
+    };
+
+    inline f32_8x F32_8X(f32 A, f32 B, f32 C, f32 D, f32 E, f32 F, f32 G, f32 H) {
+        f32_8x result;
+        result.H[0] = F32_4X(A, B, C, D);
+        result.H[1] = F32_4X(E, F, G, H);
+        return result;
+    }
+
+    inline f32_8x F32_8X(f32 A) {
+        f32_8x result;
+        result.H[0] = result.H[1] = F32_4X(A);
+        return result;
+    }
+
+    inline u32_8x U32_8X(u32 A, u32 B, u32 C, u32 D, u32 E, u32 F, u32 G, u32 H) {
+        u32_8x result;
+        result.H[0] = U32_4X(A, B, C, D);
+        result.H[1] = U32_4X(E, F, G, H);
+        return result;
+    }
+
+    inline u32_8x U32_8X(u32 A) {
+        u32_8x result;
+        result.H[0] = result.H[1] = U32_4X(A);
+        return result;
+    }
+
+    #define PERLIN_HALVES_OP(T, R, op)                          \
+        inline R operator op (T A, T B) {                       \
+            R result;                                           \
+            result.H[0] = A.H[0] op B.H[0];                     \
+            result.H[1] = A.H[1] op B.H[1];                     \
+            return result;                                      \
+        }
+
+    PERLIN_HALVES_OP(f32_8x, f32_8x, +)
+    PERLIN_HALVES_OP(f32_8x, f32_8x, -)
+    PERLIN_HALVES_OP(f32_8x, f32_8x, *)
+    PERLIN_HALVES_OP(f32_8x, f32_8x, /)
+    PERLIN_HALVES_OP(u32_8x, u32_8x, +)
+    PERLIN_HALVES_OP(u32_8x, u32_8x, *)
+    PERLIN_HALVES_OP(u32_8x, u32_8x, &)
+    PERLIN_HALVES_OP(u32_8x, u32_8x, |)
+    PERLIN_HALVES_OP(u32_8x, u32_8x, ==)
+    PERLIN_HALVES_OP(u32_8x, u32_8x, >)
+    PERLIN_HALVES_OP(u32_8x, u32_8x, <)
+    PERLIN_HALVES_OP(f32_8x, u32_8x, >)
+    PERLIN_HALVES_OP(f32_8x, u32_8x, <)
+
+    #undef PERLIN_HALVES_OP
+
+    inline f32_8x
+    _select(u32_8x mask, f32_8x A, f32_8x B) {
+        f32_8x result;
+        result.H[0] = _select(mask.H[0], A.H[0], B.H[0]);
+        result.H[1] = _select(mask.H[1], A.H[1], B.H[1]);
+        return result;
+    }
+
+    inline u32_8x
+    _cvt_u32(f32_8x A) {
+        u32_8x result;
+        result.H[0] = _cvt_u32(A.H[0]);
+        result.H[1] = _cvt_u32(A.H[1]);
+        return result;
+    }
+
+    inline f32_8x
+    _cvt_f32(u32_8x A) {
+        f32_8x result;
+        result.H[0] = _cvt_f32(A.H[0]);
+        result.H[1] = _cvt_f32(A.H[1]);
+        return result;
+    }
+
+    inline u32_8x
+    _gather(const u32* table, u32_8x index) {
+        u32_8x result;
+        result.H[0] = _gather(table, index.H[0]);
+        result.H[1] = _gather(table, index.H[1]);
+        return result;
+    }
+
+    inline f32_8x
+    _gather(const f32* table, u32_8x index) {
+        f32_8x result;
+        result.H[0] = _gather(table, index.H[0]);
+        result.H[1] = _gather(table, index.H[1]);
+        return result;
+    }
+
+    inline u32
+    _movemask(u32_8x A) {
+        return _movemask(A.H[0]) | (_movemask(A.H[1]) << 4);
+    }
+
+    inline f32_8x
+    _load_8x(const f32* p) {
+        f32_8x result;
+        result.H[0] = _load_4x(p);
+        result.H[1] = _load_4x(p + 4);
+        return result;
+    }
+
+    inline void
+    _store(f32* p, f32_8x A) {
+        _store(p, A.H[0]);
+        _store(p + 4, A.H[1]);
+    }
+
+#endif
+
+} // namespace PERLIN_NAMESPACE
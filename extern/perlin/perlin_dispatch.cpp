@@ -0,0 +1,153 @@
+#include "perlin.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// one table per ISA build of perlin.cpp, CMake tells us which ones exist
+namespace perlin_scalar { extern const perlin_kernels kernels; }
+#ifdef PERLIN_HAS_SSE41
+namespace perlin_sse41  { extern const perlin_kernels kernels; }
+#endif
+#ifdef PERLIN_HAS_AVX2
+namespace perlin_avx2   { extern const perlin_kernels kernels; }
+#endif
+#ifdef PERLIN_HAS_AVX512
+namespace perlin_avx512 { extern const perlin_kernels kernels; }
+#endif
+#ifdef PERLIN_HAS_NEON
+namespace perlin_neon   { extern const perlin_kernels kernels; }
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+
+namespace {
+
+    void cpuid (u32 leaf, u32 subleaf, u32 regs[4]) {
+    #ifdef _MSC_VER
+        int r[4];
+        __cpuidex(r, leaf, subleaf);
+        for (int i = 0; i < 4; i++) regs[i] = r[i];
+    #else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+    }
+
+    // which register state the OS saves on context switch (XCR0)
+    uint64_t xgetbv0 () {
+    #ifdef _MSC_VER
+        return _xgetbv(0);
+    #else
+        u32 eax, edx;
+        __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return ((uint64_t)edx << 32) | eax;
+    #endif
+    }
+
+    struct cpu_features {
+        bool sse41 = false;
+        bool avx2 = false;
+        bool avx512 = false;
+    };
+
+    cpu_features detect_cpu () {
+        cpu_features cpu;
+        u32 r[4];
+
+        cpuid(0, 0, r);
+        u32 max_leaf = r[0];
+        if (max_leaf < 1) return cpu;
+
+        cpuid(1, 0, r);
+        u32 ecx1 = r[2];
+        cpu.sse41 = ecx1 & (1u << 19);
+
+        bool osxsave = ecx1 & (1u << 27);
+        bool avx     = ecx1 & (1u << 28);
+        bool fma     = ecx1 & (1u << 12);
+        if (!osxsave || !avx || max_leaf < 7) return cpu;
+
+        uint64_t xcr0 = xgetbv0();
+        bool ymm_state = (xcr0 & 0x06) == 0x06;  // xmm + ymm
+        bool zmm_state = (xcr0 & 0xE6) == 0xE6;  // + opmask, zmm hi256, hi16 zmm
+
+        cpuid(7, 0, r);
+        u32 ebx7 = r[1];
+        cpu.avx2 = ymm_state && fma && (ebx7 & (1u << 5));
+
+        bool avx512f  = ebx7 & (1u << 16);
+        bool avx512dq = ebx7 & (1u << 17);
+        bool avx512bw = ebx7 & (1u << 30);
+        bool avx512vl = ebx7 & (1u << 31);
+        cpu.avx512 = cpu.avx2 && zmm_state && avx512f && avx512dq && avx512bw && avx512vl;
+
+        return cpu;
+    }
+}
+
+#endif
+
+int perlin_supported_kernels (const perlin_kernels* out[PERLIN_MAX_KERNELS]) {
+    int count = 0;
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    cpu_features cpu = detect_cpu();
+    #ifdef PERLIN_HAS_AVX512
+    if (cpu.avx512) out[count++] = &perlin_avx512::kernels;
+    #endif
+    #ifdef PERLIN_HAS_AVX2
+    if (cpu.avx2)   out[count++] = &perlin_avx2::kernels;
+    #endif
+    #ifdef PERLIN_HAS_SSE41
+    if (cpu.sse41)  out[count++] = &perlin_sse41::kernels;
+    #endif
+#endif
+
+#ifdef PERLIN_HAS_NEON
+    // NEON is part of the aarch64 baseline
+    out[count++] = &perlin_neon::kernels;
+#endif
+
+    out[count++] = &perlin_scalar::kernels;
+    return count;
+}
+
+namespace {
+
+    const perlin_kernels* select_kernels () {
+        const perlin_kernels* supported[PERLIN_MAX_KERNELS];
+        int count = perlin_supported_kernels(supported);
+
+        const char* forced = std::getenv("PERLIN_ISA");
+        if (forced) {
+            for (int i = 0; i < count; i++) {
+                if (std::strcmp(forced, supported[i]->name) == 0)
+                    return supported[i];
+            }
+        }
+
+        return supported[0];
+    }
+}
+
+const perlin_kernels& perlin_get_kernels () {
+    static const perlin_kernels* selected = select_kernels();
+    return *selected;
+}
+
+// trilinear interpolation over a cell of side h is off by at most
+// h^2/8 * (|n_xx| + |n_yy| + |n_zz|). the quintic fade keeps each second
+// derivative of the noise under 12 (measured ~11.5), so the bound is 4.5 h^2
+u32 perlin_coarse_step (f32 f, f32 max_error, u32 max_step) {
+    u32 step = 1;
+    while (step * 2 <= max_step) {
+        f32 h = step * 2 * f;
+        if (4.5f * h * h > max_error) break;
+        step *= 2;
+    }
+    return step;
+}
@@ -1,37 +1,67 @@
 #pragma once
 
-#include <cstdio> 
+#include <cstdio>
 #include <random>
-#include <functional> 
-#include <iostream> 
-#include <fstream> 
-#include <cmath> 
+#include <functional>
+#include <iostream>
+#include <fstream>
+#include <cmath>
 #include <cstdlib>
 #include <vector> // Added for std::vector
 #include <stdint.h>
 #include <filesystem>
-#include <arm_neon.h>
 #include "stb_image_write.h"
+#include "perlin.h"
 
-typedef float f32;
-typedef uint32_t u32;
-typedef int32_t s32;
-static const unsigned kMaxTableSize = 256; 
+static const unsigned kMaxTableSize = 256;
 static const unsigned kMaxTableSizeMask = kMaxTableSize - 1;
 
-// https://stackoverflow.com/questions/13772567/how-to-get-the-cpu-cycle-count-in-x86-64-from-c
-#ifdef _WIN32
+// backend is picked at compile time, x86 needs at least -msse4.1 (blendv)
+// define PERLIN_FORCE_SCALAR to get the plain C++ reference path
+#if !defined(PERLIN_FORCE_SCALAR) && (defined(__SSE4_1__) || defined(_M_X64))
+    #define PERLIN_SIMD_SSE41 1
+#elif !defined(PERLIN_FORCE_SCALAR) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    #define PERLIN_SIMD_NEON 1
+#else
+    #define PERLIN_SIMD_SCALAR 1
+#endif
 
+#if defined(PERLIN_SIMD_SSE41)
     #include <smmintrin.h>
     #include <emmintrin.h>
     #include <xmmintrin.h>
-    #include <intrin.h>
-    uint64_t read_cycle_counter(){
-        // Serialize with CPUID
-        int cpuInfo[4];
-        __cpuid(cpuInfo, 0);
-        return __rdtsc();
-    }
+    #ifdef _WIN32
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#elif defined(PERLIN_SIMD_NEON)
+    #include <arm_neon.h>
+#endif
+
+// every ISA build of perlin.cpp gets its own copy of the wrapper types, so
+// the linker can never merge e.g. the AVX2 operator+ into the SSE4.1 kernels
+#ifndef PERLIN_NAMESPACE
+    #define PERLIN_NAMESPACE perlin_native
+#endif
+
+namespace PERLIN_NAMESPACE {
+
+#if defined(PERLIN_SIMD_SSE41)
+
+    // https://stackoverflow.com/questions/13772567/how-to-get-the-cpu-cycle-count-in-x86-64-from-c
+    #ifdef _WIN32
+        inline uint64_t read_cycle_counter(){
+            // Serialize with CPUID
+            int cpuInfo[4];
+            __cpuid(cpuInfo, 0);
+            return __rdtsc();
+        }
+    #else
+        inline uint64_t read_cycle_counter(){
+            return __rdtsc();
+        }
+    #endif
 
     union f32_4x
     {
@@ -51,11 +81,35 @@ static const unsigned kMaxTableSizeMask = kMaxTableSize - 1;
     }
 
     inline f32_4x F32_4X(f32 A) {
-        // set backwards
         f32_4x result = {{ _mm_set_ps1(A) }};
         return result;
     }
 
+    inline f32_4x F32_4X(__m128 A) {
+
+        f32_4x res;
+        res.sse = A;
+        return res;
+    }
+
+    inline u32_4x U32_4X(u32 A, u32 B, u32 C, u32 D) {
+        // set backwards
+        u32_4x result = {{ _mm_set_epi32(D,C,B,A) }};
+        return result;
+    }
+
+    inline u32_4x U32_4X(u32 A) {
+        u32_4x result = {{ _mm_set1_epi32(A) }};
+        return result;
+    }
+
+    inline u32_4x U32_4X(__m128i A) {
+
+        u32_4x res;
+        res.sse = A;
+        return res;
+    }
+
     inline f32_4x
     operator+ (f32_4x A, f32_4x B)
     {
@@ -78,48 +132,144 @@ static const unsigned kMaxTableSizeMask = kMaxTableSize - 1;
     }
 
     inline f32_4x
-    operator& (f32_4x A, f32_4x B)
+    operator/ (f32_4x A, f32_4x B)
     {
-        f32_4x result = {{ _mm_and_ps(A.sse, B.sse) }};
+        f32_4x result = {{ _mm_div_ps(A.sse, B.sse) }};
         return result;
     }
 
-    inline f32_4x
-    operator| (f32_4x A, f32_4x B)
+    inline u32_4x
+    operator+ (u32_4x A, u32_4x B)
     {
-        f32_4x result = {{ _mm_or_ps(A.sse, B.sse) }};
+        u32_4x result = {{ _mm_add_epi32(A.sse, B.sse) }};
         return result;
     }
 
-    inline f32_4x
-    operator==(f32_4x A, f32_4x B)
+    inline u32_4x
+    operator* (u32_4x A, u32_4x B)
     {
-    f32_4x result = {{ _mm_cmpeq_ps(A.sse, B.sse) }};
-    return result;
+        u32_4x result = {{ _mm_mullo_epi32(A.sse, B.sse) }};
+        return result;
     }
 
-    inline f32_4x
+    inline u32_4x
+    operator& (u32_4x A, u32_4x B)
+    {
+        u32_4x result = {{ _mm_and_si128(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_4x
+    operator| (u32_4x A, u32_4x B)
+    {
+        u32_4x result = {{ _mm_or_si128(A.sse, B.sse) }};
+        return result;
+    }
+
+    // lane values are small (hashes, lattice coords), signed compare is fine
+    inline u32_4x
+    operator==(u32_4x A, u32_4x B)
+    {
+        u32_4x result = {{ _mm_cmpeq_epi32(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_4x
+    operator>(u32_4x A, u32_4x B)
+    {
+        u32_4x result = {{ _mm_cmpgt_epi32(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_4x
+    operator<(u32_4x A, u32_4x B)
+    {
+        u32_4x result = {{ _mm_cmplt_epi32(A.sse, B.sse) }};
+        return result;
+    }
+
+    inline u32_4x
     operator>(f32_4x A, f32_4x B)
     {
-    f32_4x result = {{ _mm_cmpgt_ps(A.sse, B.sse) }};
-    return result;
+        u32_4x result = {{ _mm_castps_si128(_mm_cmpgt_ps(A.sse, B.sse)) }};
+        return result;
     }
 
-    inline f32_4x
+    inline u32_4x
     operator<(f32_4x A, f32_4x B)
     {
-    f32_4x result = {{ _mm_cmplt_ps(A.sse, B.sse) }};
-    return result;
+        u32_4x result = {{ _mm_castps_si128(_mm_cmplt_ps(A.sse, B.sse)) }};
+        return result;
     }
 
-    inline
-    f32_4x _select(u32_4x mask, f32_4x A, f32_4x B) {
+    inline f32_4x
+    _select(u32_4x mask, f32_4x A, f32_4x B) {
         f32_4x result;
-        result.sse = _mm_blendv_ps(B.sse, A.sse, mask.sse);;
+        result.sse = _mm_blendv_ps(B.sse, A.sse, _mm_castsi128_ps(mask.sse));
         return result;
     }
 
-#else
+    // truncating float -> u32, negatives clamp to 0 (same as vcvtq_u32_f32)
+    inline u32_4x
+    _cvt_u32(f32_4x A) {
+        u32_4x result = {{ _mm_cvttps_epi32(_mm_max_ps(A.sse, _mm_setzero_ps())) }};
+        return result;
+    }
+
+    inline f32_4x
+    _cvt_f32(u32_4x A) {
+        f32_4x result = {{ _mm_cvtepi32_ps(A.sse) }};
+        return result;
+    }
+
+    // table[index] per lane
+    inline u32_4x
+    _gather(const u32* table, u32_4x index) {
+    #if defined(__AVX2__)
+        u32_4x result = {{ _mm_i32gather_epi32((const int*)table, index.sse, 4) }};
+    #else
+        // no gather before AVX2: every lane goes out to a general register
+        // and is one scalar load. a pshufb lookup over the 256 byte table
+        // (16 shuffles per 4 lanes) measured several times slower than this
+        u32_4x result = {{ _mm_set_epi32(table[_mm_extract_epi32(index.sse, 3)],
+                                         table[_mm_extract_epi32(index.sse, 2)],
+                                         table[_mm_extract_epi32(index.sse, 1)],
+                                         table[_mm_cvtsi128_si32(index.sse)]) }};
+    #endif
+        return result;
+    }
+
+    inline f32_4x
+    _gather(const f32* table, u32_4x index) {
+    #if defined(__AVX2__)
+        f32_4x result = {{ _mm_i32gather_ps(table, index.sse, 4) }};
+    #else
+        f32_4x result = {{ _mm_set_ps(table[_mm_extract_epi32(index.sse, 3)],
+                                      table[_mm_extract_epi32(index.sse, 2)],
+                                      table[_mm_extract_epi32(index.sse, 1)],
+                                      table[_mm_cvtsi128_si32(index.sse)]) }};
+    #endif
+        return result;
+    }
+
+    // sign bit of every lane, lane 0 in bit 0
+    inline u32
+    _movemask(u32_4x A) {
+        return _mm_movemask_ps(_mm_castsi128_ps(A.sse));
+    }
+
+    inline f32_4x
+    _load_4x(const f32* p) {
+        f32_4x result = {{ _mm_loadu_ps(p) }};
+        return result;
+    }
+
+    inline void
+    _store(f32* p, f32_4x A) {
+        _mm_storeu_ps(p, A.sse);
+    }
+
+#elif defined(PERLIN_SIMD_NEON)
 
     // #include <mach/mach_time.h>
     // static inline uint64_t read_cycle_counter() {
@@ -202,7 +352,14 @@ static const unsigned kMaxTableSizeMask = kMaxTableSize - 1;
     {
         f32_4x result = { vdivq_f32(A.sse, B.sse) };
         return result;
-    } 
+    }
+
+    inline u32_4x
+    operator+ (u32_4x A, u32_4x B)
+    {
+        u32_4x result = { vaddq_u32(A.sse, B.sse) };
+        return result;
+    }
 
     inline u32_4x
     operator* (u32_4x A, u32_4x B)
@@ -228,19 +385,33 @@ static const unsigned kMaxTableSizeMask = kMaxTableSize - 1;
     inline u32_4x
     operator==(u32_4x A, u32_4x B)
     {
-        u32_4x result = { vceqq_f32(A.sse, B.sse) };
+        u32_4x result = { vceqq_u32(A.sse, B.sse) };
         return result;
     }
 
     inline u32_4x
     operator>(u32_4x A, u32_4x B)
     {
-        u32_4x result = { vcgtq_f32(A.sse, B.sse) };
+        u32_4x result = { vcgtq_u32(A.sse, B.sse) };
         return result;
     }
 
     inline u32_4x
     operator<(u32_4x A, u32_4x B)
+    {
+        u32_4x result = { vcltq_u32(A.sse, B.sse) };
+        return result;
+    }
+
+    inline u32_4x
+    operator>(f32_4x A, f32_4x B)
+    {
+        u32_4x result = { vcgtq_f32(A.sse, B.sse) };
+        return result;
+    }
+
+    inline u32_4x
+    operator<(f32_4x A, f32_4x B)
     {
         u32_4x result = { vcltq_f32(A.sse, B.sse) };
         return result;
@@ -249,9 +420,173 @@ static const unsigned kMaxTableSizeMask = kMaxTableSize - 1;
     inline f32_4x
     _select(u32_4x mask, f32_4x A, f32_4x B) {
         f32_4x result;
-        result.sse = vbslq_f32(mask.sse, A.sse, B.sse);;
+        result.sse = vbslq_f32(mask.sse, A.sse, B.sse);
+        return result;
+    }
+
+    inline u32_4x
+    _cvt_u32(f32_4x A) {
+        u32_4x result = { vcvtq_u32_f32(A.sse) };
+        return result;
+    }
+
+    inline f32_4x
+    _cvt_f32(u32_4x A) {
+        f32_4x result = { vcvtq_f32_u32(A.sse) };
+        return result;
+    }
+
+    // table[index] per lane, NEON has no gather so this is one scalar load
+    // per lane. a vqtbl4q_u8 lookup over a byte copy of the table would avoid
+    // them, but hasn't been built or measured on arm yet
+    inline u32_4x
+    _gather(const u32* table, u32_4x index) {
+        uint32x4_t r = vld1q_dup_u32(table + vgetq_lane_u32(index.sse, 0));
+        r = vld1q_lane_u32(table + vgetq_lane_u32(index.sse, 1), r, 1);
+        r = vld1q_lane_u32(table + vgetq_lane_u32(index.sse, 2), r, 2);
+        r = vld1q_lane_u32(table + vgetq_lane_u32(index.sse, 3), r, 3);
+        u32_4x result = { r };
+        return result;
+    }
+
+    inline f32_4x
+    _gather(const f32* table, u32_4x index) {
+        float32x4_t r = vld1q_dup_f32(table + vgetq_lane_u32(index.sse, 0));
+        r = vld1q_lane_f32(table + vgetq_lane_u32(index.sse, 1), r, 1);
+        r = vld1q_lane_f32(table + vgetq_lane_u32(index.sse, 2), r, 2);
+        r = vld1q_lane_f32(table + vgetq_lane_u32(index.sse, 3), r, 3);
+        f32_4x result = { r };
+        return result;
+    }
+
+    // sign bit of every lane, lane 0 in bit 0
+    inline u32
+    _movemask(u32_4x A) {
+        const uint32_t weights[4] = { 1, 2, 4, 8 };
+        uint32x4_t lanes = vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_u32(A.sse), 31));
+        return vaddvq_u32(vandq_u32(lanes, vld1q_u32(weights)));
+    }
+
+    inline f32_4x
+    _load_4x(const f32* p) {
+        f32_4x result = { vld1q_f32(p) };
+        return result;
+    }
+
+    inline void
+    _store(f32* p, f32_4x A) {
+        vst1q_f32(p, A.sse);
+    }
+
+#else
+
+    // reference path, same semantics as the intrinsics versions lane by lane
+    union f32_4x
+    {
+        f32 E[4];
+    };
+
+    union u32_4x {
+        u32 E[4];
+    };
+
+    inline f32_4x F32_4X(f32 A, f32 B, f32 C, f32 D) {
+        f32_4x result = {{ A, B, C, D }};
+        return result;
+    }
+
+    inline f32_4x F32_4X(f32 A) {
+        f32_4x result = {{ A, A, A, A }};
+        return result;
+    }
+
+    inline u32_4x U32_4X(u32 A, u32 B, u32 C, u32 D) {
+        u32_4x result = {{ A, B, C, D }};
+        return result;
+    }
+
+    inline u32_4x U32_4X(u32 A) {
+        u32_4x result = {{ A, A, A, A }};
+        return result;
+    }
+
+    #define PERLIN_SCALAR_OP(T, R, op, expr)                \
+        inline R operator op (T A, T B) {                   \
+            R result;                                       \
+            for (int i = 0; i < 4; i++) result.E[i] = expr; \
+            return result;                                  \
+        }
+
+    PERLIN_SCALAR_OP(f32_4x, f32_4x, +, A.E[i] + B.E[i])
+    PERLIN_SCALAR_OP(f32_4x, f32_4x, -, A.E[i] - B.E[i])
+    PERLIN_SCALAR_OP(f32_4x, f32_4x, *, A.E[i] * B.E[i])
+    PERLIN_SCALAR_OP(f32_4x, f32_4x, /, A.E[i] / B.E[i])
+    PERLIN_SCALAR_OP(u32_4x, u32_4x, +, A.E[i] + B.E[i])
+    PERLIN_SCALAR_OP(u32_4x, u32_4x, *, A.E[i] * B.E[i])
+    PERLIN_SCALAR_OP(u32_4x, u32_4x, &, A.E[i] & B.E[i])
+    PERLIN_SCALAR_OP(u32_4x, u32_4x, |, A.E[i] | B.E[i])
+    PERLIN_SCALAR_OP(u32_4x, u32_4x, ==, A.E[i] == B.E[i] ? 0xFFFFFFFFu : 0u)
+    PERLIN_SCALAR_OP(u32_4x, u32_4x, >,  A.E[i] >  B.E[i] ? 0xFFFFFFFFu : 0u)
+    PERLIN_SCALAR_OP(u32_4x, u32_4x, <,  A.E[i] <  B.E[i] ? 0xFFFFFFFFu : 0u)
+    PERLIN_SCALAR_OP(f32_4x, u32_4x, >,  A.E[i] >  B.E[i] ? 0xFFFFFFFFu : 0u)
+    PERLIN_SCALAR_OP(f32_4x, u32_4x, <,  A.E[i] <  B.E[i] ? 0xFFFFFFFFu : 0u)
+
+    #undef PERLIN_SCALAR_OP
+
+    inline f32_4x
+    _select(u32_4x mask, f32_4x A, f32_4x B) {
+        f32_4x result;
+        for (int i = 0; i < 4; i++) result.E[i] = mask.E[i] ? A.E[i] : B.E[i];
+        return result;
+    }
+
+    inline u32_4x
+    _cvt_u32(f32_4x A) {
+        u32_4x result;
+        for (int i = 0; i < 4; i++) result.E[i] = A.E[i] > 0 ? (u32)A.E[i] : 0;
+        return result;
+    }
+
+    inline f32_4x
+    _cvt_f32(u32_4x A) {
+        f32_4x result;
+        for (int i = 0; i < 4; i++) result.E[i] = (f32)A.E[i];
         return result;
     }
 
-    void perlinNoiseSIMD_4x (const f32 x, const f32 y, const f32 z, const f32 f, uint8_t *data);
-#endif
\ No newline at end of file
+    inline u32_4x
+    _gather(const u32* table, u32_4x index) {
+        u32_4x result;
+        for (int i = 0; i < 4; i++) result.E[i] = table[index.E[i]];
+        return result;
+    }
+
+    inline f32_4x
+    _gather(const f32* table, u32_4x index) {
+        f32_4x result;
+        for (int i = 0; i < 4; i++) result.E[i] = table[index.E[i]];
+        return result;
+    }
+
+    inline u32
+    _movemask(u32_4x A) {
+        u32 result = 0;
+        for (int i = 0; i < 4; i++) result |= (A.E[i] >> 31) << i;
+        return result;
+    }
+
+    inline f32_4x
+    _load_4x(const f32* p) {
+        f32_4x result;
+        for (int i = 0; i < 4; i++) result.E[i] = p[i];
+        return result;
+    }
+
+    inline void
+    _store(f32* p, f32_4x A) {
+        for (int i = 0; i < 4; i++) p[i] = A.E[i];
+    }
+
+#endif
+
+} // namespace PERLIN_NAMESPACE
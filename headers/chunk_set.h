@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+// a set of chunk coordinates in one flat array: open addressing, linear
+// probing, erase shifts the following run back so there are no tombstones.
+// kept at most half full. a slot holding kEmpty is free, so that coordinate
+// can't be stored (no chunk is ever near INT_MIN)
+class chunk_set {
+public:
+
+    chunk_set () { slots.assign(16, kEmpty); }
+
+    // the three coordinates in one word, 21 bits each (two's complement)
+    static uint64_t pack (glm::ivec3 v) {
+        return (uint64_t)(v.x & 0x1fffff) | (uint64_t)(v.y & 0x1fffff) << 21 | (uint64_t)(v.z & 0x1fffff) << 42;
+    }
+
+    // spreads neighbouring coordinates over the whole table: pack, then
+    // murmur3's finalizer
+    static uint64_t hash (glm::ivec3 v) {
+        uint64_t h = pack(v);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    bool insert (glm::ivec3 v) {
+        if ((used + 1) * 2 > slots.size()) grow();
+        size_t i = find(v);
+        if (slots[i] == v) return false;
+        slots[i] = v;
+        used++;
+        return true;
+    }
+
+    bool erase (glm::ivec3 v) {
+        size_t mask = slots.size() - 1;
+        size_t i = find(v);
+        if (slots[i] != v) return false;
+
+        // pull back every later entry of the run that would no longer be
+        // reachable from its home slot across the hole
+        for (size_t j = (i + 1) & mask; slots[j] != kEmpty; j = (j + 1) & mask) {
+            size_t home = hash(slots[j]) & mask;
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i] = kEmpty;
+        used--;
+        return true;
+    }
+
+    size_t count (glm::ivec3 v) const { return slots[find(v)] == v; }
+    size_t size () const { return used; }
+    bool empty () const { return used == 0; }
+
+    class iterator {
+    public:
+        iterator (const glm::ivec3* p, const glm::ivec3* end) : p(p), end(end) { skip(); }
+        const glm::ivec3& operator* () const { return *p; }
+        iterator& operator++ () { p++; skip(); return *this; }
+        bool operator!= (const iterator& o) const { return p != o.p; }
+    private:
+        const glm::ivec3* p;
+        const glm::ivec3* end;
+        void skip () { while (p != end && *p == kEmpty) p++; }
+    };
+
+    // in slot order, which is no particular order
+    iterator begin () const { return iterator(slots.data(), slots.data() + slots.size()); }
+    iterator end () const { return iterator(slots.data() + slots.size(), slots.data() + slots.size()); }
+
+private:
+
+    static inline const glm::ivec3 kEmpty = glm::ivec3(INT_MIN);
+
+    std::vector<glm::ivec3> slots; // size is a power of two
+    size_t used = 0;
+
+    // v's slot, or the free slot where it would go
+    size_t find (glm::ivec3 v) const {
+        size_t mask = slots.size() - 1;
+        size_t i = hash(v) & mask;
+        while (slots[i] != v && slots[i] != kEmpty) i = (i + 1) & mask;
+        return i;
+    }
+
+    void grow () {
+        std::vector<glm::ivec3> old(slots.size() * 2, kEmpty);
+        old.swap(slots);
+        for (const glm::ivec3& v : old)
+            if (v != kEmpty) slots[find(v)] = v;
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// what the render thread keeps of a chunk once its mesh is in the arena
+struct chunk_record {
+    glm::ivec3 pos;
+    bool loaded = false;
+    float noise_error = 0;
+    uint32_t range = 0;      // its mesh in the generator's mesh_arena, 0 for none
+    int vertexCount = 0;
+    uint32_t face_quads[6] = {};
+};
+
+// the loaded chunks, in a size^3 array that wraps around: a chunk lives at
+// its coordinates modulo size on each axis. any size^3 box of chunks maps
+// onto the array one to one, so as long as the loaded ones stay inside such
+// a box (the wanted region) lookups are arithmetic and moving never rehashes.
+// a slot that still holds a chunk from the other side of the box has to be
+// erased before it is reused
+class chunk_window {
+public:
+
+    explicit chunk_window (int size) : size(size), records(size * size * size) {}
+
+    // the chunk at pos, or null when it isn't loaded
+    chunk_record* find (glm::ivec3 pos) {
+        chunk_record& r = slot(pos);
+        return r.loaded && r.pos == pos ? &r : nullptr;
+    }
+
+    // where pos goes, whatever it holds now
+    chunk_record& slot (glm::ivec3 pos) {
+        return records[(wrap(pos.x) * size + wrap(pos.y)) * size + wrap(pos.z)];
+    }
+
+    // every slot, loaded or not, in memory order
+    std::vector<chunk_record>& slots () { return records; }
+
+private:
+
+    int size;
+    std::vector<chunk_record> records;
+
+    int wrap (int v) const {
+        int m = v % size;
+        return m < 0 ? m + size : m;
+    }
+};
@@ -1,10 +1,58 @@
 #pragma once
 #include "helpers.h"
 #include "frustrum.h"
+#include "mesh_arena.h"
+#include "chunk_window.h"
 #include <vector>
 #include <tbb/concurrent_queue.h>
 #include <tbb/task_group.h>
+#include <tbb/task_arena.h>
 #include "stb_image.h"
+
+// the chunks kept around the camera: every chunk within radius (chebyshev) of
+// the camera's chunk. packed in one word (21 bits per axis) so workers can read
+// it without a lock. the word changes exactly when the box moves, so it is its own version
+struct wanted_region {
+    static const int radius = RENDER_DISTANCE / 2;
+
+    static uint64_t pack (glm::ivec3 center) { return chunk_set::pack(center); }
+
+    template <typename Fn>
+    static void for_each (glm::ivec3 center, int radius, Fn fn) {
+        for (int x = center.x - radius; x <= center.x + radius; x++)
+            for (int y = center.y - radius; y <= center.y + radius; y++)
+                for (int z = center.z - radius; z <= center.z + radius; z++)
+                    fn(glm::ivec3(x, y, z));
+    }
+
+    // the chunks within radius of center but not of other. a column whose x
+    // and y are inside other's box only visits the z outside it
+    template <typename Fn>
+    static void for_each_outside (glm::ivec3 center, glm::ivec3 other, int radius, Fn fn) {
+        for (int x = center.x - radius; x <= center.x + radius; x++) {
+            for (int y = center.y - radius; y <= center.y + radius; y++) {
+                int z = center.z - radius;
+                int z_end = center.z + radius;
+                if (std::abs(x - other.x) <= radius && std::abs(y - other.y) <= radius) {
+                    for (; z <= std::min(z_end, other.z - radius - 1); z++) fn(glm::ivec3(x, y, z));
+                    z = std::max(z, other.z + radius + 1);
+                }
+                for (; z <= z_end; z++) fn(glm::ivec3(x, y, z));
+            }
+        }
+    }
+
+    static glm::ivec3 unpack (uint64_t region) {
+        // sign extend each field back
+        return glm::ivec3((int64_t)(region << 43) >> 43, (int64_t)(region << 22) >> 43, (int64_t)(region << 1) >> 43);
+    }
+
+    static bool contains (glm::ivec3 center, glm::ivec3 pos) {
+        glm::ivec3 d = glm::abs(pos - center);
+        return std::max(d.x, std::max(d.y, d.z)) <= radius;
+    }
+};
+
 class generator {
 
 public:
@@ -39,38 +87,105 @@ generator (Program* ShaderProgram) {
     glBindTexture(GL_TEXTURE_2D, texture);
 
     stbi_image_free(data);
+
+    upload.init(UPLOAD_RING_SIZE);
+    reserve_quad_indices(1);
+    arena.init(MESH_ARENA_SIZE / (4 * sizeof(uint32_t)), quad_ebo);
+
+    // attribute 1 of the arena VAO is the chunk's world offset. with multi
+    // draw indirect it is one vec3 per draw (picked by base_instance),
+    // otherwise the array stays off and each draw sets the current value
+    multi_draw = GLAD_GL_VERSION_4_3;
+    if (multi_draw) {
+        glGenBuffers(1, &draw_offset_buffer);
+        glGenBuffers(1, &draw_command_buffer);
+        glBindVertexArray(arena.get_vao());
+        glBindBuffer(GL_ARRAY_BUFFER, draw_offset_buffer);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
 }
 
-void start_generation_tasks (const std::unordered_set<glm::ivec3, IVec3Hash>& required) {
+// follows the camera's chunk. only the chunks that enter or leave the
+// region (or cross into fine noise) are looked at, nothing when it stays put
+void update_region () {
+    glm::ivec3 center = glm::ivec3(glm::floor(cameraPos / (float)CHUNK_LENGTH));
+    if (region_valid && center == region_center) return;
 
-    for (const auto& pos : required) {
-        if (!active_chunks.count(pos)) { 
-            std::lock_guard<std::mutex> lock(m_pending_mutex);
-            if (m_pending_generation.insert(pos).second) { 
-                tasks_in_flight.fetch_add(1, std::memory_order_relaxed);
-                task_group.run([this, pos, required]() { 
-                    if (!required.count(pos)) return;
-                    generate_chunk(pos);
-                    tasks_in_flight.fetch_sub(1, std::memory_order_relaxed);
-                });
-            }
-        }
+    const int radius = wanted_region::radius;
+    const int fine_radius = COARSE_NOISE_DISTANCE - 1;
+
+    if (!region_valid) {
+        wanted_region::for_each(center, radius, [&](glm::ivec3 pos) { to_generate.insert(pos); });
+    } else {
+        // delete all chunks in memory that are not needed
+        wanted_region::for_each_outside(region_center, center, radius, [&](glm::ivec3 pos) {
+            to_generate.erase(pos);
+            chunk_record* chunk = active_chunks.find(pos);
+            if (!chunk) return;
+            arena.free(chunk->range);
+            chunk->loaded = false;
+        });
+        wanted_region::for_each_outside(center, region_center, radius, [&](glm::ivec3 pos) { to_generate.insert(pos); });
+
+        // close enough now for full rate noise
+        wanted_region::for_each_outside(center, region_center, fine_radius, [&](glm::ivec3 pos) {
+            chunk_record* chunk = active_chunks.find(pos);
+            if (chunk && chunk->noise_error > 0) to_generate.insert(pos);
+        });
+        arena.maybe_compact();
     }
+
+    region_center = center;
+    region_valid = true;
+    // queued jobs that fall outside are skipped by the workers
+    wanted.store(wanted_region::pack(center), std::memory_order_relaxed);
 }
 
-void prune_unnecessary_chunks (const std::unordered_set<glm::ivec3, IVec3Hash>& required) {
-    // delete all chunks in memory that are not needed
-    std::erase_if(active_chunks, [&](const auto& pair) {
-        const glm::ivec3& pos = pair.first;
-        return !required.count(pos);
-    });
+// queues to_generate, nearest first. runs every frame, so the order follows the camera
+void start_generation_tasks (const glm::mat4& view_projection) {
+
+    Frustum frustum;
+    frustum.update(view_projection);
+
+    std::vector<chunk_job> jobs;
+    for (const auto& pos : to_generate) {
+        // squared distance, a quarter of it (half the distance) in view. a
+        // finer copy of a chunk already on screen waits as if twice as far
+        glm::vec3 min = glm::vec3(pos) * (float)CHUNK_LENGTH;
+        glm::vec3 max = min + glm::vec3(CHUNK_LENGTH);
+        glm::vec3 to_chunk = (min + max) * 0.5f - cameraPos;
+        float priority = glm::dot(to_chunk, to_chunk);
+        if (frustum.isBoxVisible(min, max)) priority *= 0.25f;
+        if (active_chunks.find(pos)) priority *= 4;
+
+        jobs.push_back({pos, needed_error(pos), priority});
+    }
+    // best last, workers pop from the back
+    std::sort(jobs.begin(), jobs.end(), [](const chunk_job& a, const chunk_job& b) { return a.priority > b.priority; });
+
+    std::lock_guard<std::mutex> lock(m_pending_mutex);
+
+    // already running ones keep going
+    std::erase_if(jobs, [&](const chunk_job& job) { return m_pending_generation.count(job.pos); });
+
+    // last frame's queue goes, whatever is left of it is in this one too
+    job_queue.swap(jobs);
+
+    int wanted = std::min<int>(job_queue.size(), tbb::this_task_arena::max_concurrency());
+    for (; workers < wanted; workers++)
+        task_group.run([this]() { run_jobs(); });
 }
 
-void process_finished_mesh (const std::unordered_set<glm::ivec3, IVec3Hash>& required) {
+void process_finished_mesh () {
 
     const auto budget = std::chrono::milliseconds(20);
     auto start_time = std::chrono::high_resolution_clock::now();
 
+    upload.retire();
+
     chunkData mesh;
     while (true) {
         auto now = std::chrono::high_resolution_clock::now();
@@ -78,24 +193,33 @@ void process_finished_mesh (const std::unordered_set<glm::ivec3, IVec3Hash>& req
             return; // if popping for 5 ms straight, stop. 
         }
         // pop all data from finished_mesh_queue
-        if (!finished_mesh_queue.try_pop(mesh)) continue;
-
-        if (!required.count(mesh.pos)) continue;
-
-        auto chunk_ptr = std::make_unique<chunkData>();
-        chunk_ptr->pos = std::move(mesh.pos);
-        chunk_ptr->vertices = std::move(mesh.vertices);
-        chunk_ptr->normals = std::move(mesh.normals);
-        chunk_ptr->textures = std::move(mesh.textures);
-
-        set_vao_vbo(*chunk_ptr);
-
-        active_chunks[chunk_ptr->pos] = std::move(chunk_ptr); 
+        if (!finished_mesh_queue.try_pop(mesh)) return;
 
         {
             std::lock_guard<std::mutex> lock(m_pending_mutex);
             m_pending_generation.erase(mesh.pos);
         }
+
+        if (!wanted_region::contains(region_center, mesh.pos)) {
+            upload.discard(mesh.staged);
+            generator_helper::scratch_pool.release_vertices(std::move(mesh.vertices));
+            continue;
+        }
+
+        // a coarse mesh of a chunk the camera got close to still gets replaced
+        if (mesh.noise_error <= needed_error(mesh.pos)) to_generate.erase(mesh.pos);
+
+        upload_mesh(mesh);
+
+        // a finer regeneration replaces the chunk
+        chunk_record& slot = active_chunks.slot(mesh.pos);
+        if (slot.loaded) arena.free(slot.range);
+        slot.pos = mesh.pos;
+        slot.loaded = true;
+        slot.noise_error = mesh.noise_error;
+        slot.range = mesh.range;
+        slot.vertexCount = mesh.vertexCount;
+        std::copy(std::begin(mesh.face_quads), std::end(mesh.face_quads), slot.face_quads);
     }
 }
 
@@ -117,23 +241,27 @@ void draw_all (Program* ShaderProgram, const glm::mat4& view, const glm::mat4& p
     glBindTexture(GL_TEXTURE_2D, this->texture);
     glUniform1i(glGetUniformLocation(ShaderProgram->get_id(), "textureSampler"), 0);
 
-    // Get the location of the model uniform ONCE before the loop for efficiency
-    GLint modelLoc = glGetUniformLocation(ShaderProgram->get_id(), "model");
-
     Frustum frustum;
     frustum.update(projection * view);
 
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+
     int chunksDrawn = 0;
 
     // std::unordered_set<glm::ivec3, IVec3Hash> viewable_chunks;
     // occlusion_culling(viewable_chunks);
 
-    for (const auto& pair : active_chunks) {
-        const chunkData* data = pair.second.get();
-        if (data->vertices.size() == 0) continue;
-        // if (!viewable_chunks.contains(pair.first)) continue;
+    // every mesh is a range of the arena's buffer
+    glBindVertexArray(arena.get_vao());
+
+    draw_commands.clear();
+    draw_offsets.clear();
+
+    for (const chunk_record& chunk : active_chunks.slots()) {
+        if (!chunk.loaded || chunk.vertexCount == 0) continue;
+        // if (!viewable_chunks.contains(chunk.pos)) continue;
 
-        glm::vec3 min = glm::vec3(data->pos) * (float)CHUNK_LENGTH;
+        glm::vec3 min = glm::vec3(chunk.pos) * (float)CHUNK_LENGTH;
         glm::vec3 max = min + glm::vec3(CHUNK_LENGTH, CHUNK_LENGTH, CHUNK_LENGTH);
 
         if (!frustum.isBoxVisible(min, max)) {
@@ -142,16 +270,45 @@ void draw_all (Program* ShaderProgram, const glm::mat4& view, const glm::mat4& p
 
         chunksDrawn++;
 
-        glm::mat4 model = glm::mat4(1.0f);
-        // The key 'pos' is the chunk's grid coordinate (e.g., (1, 0, 2)).
-        // We multiply by CHUNK_LENGTH to get the real world coordinate (e.g., (16, 0, 32)).
-        model = glm::translate(model, min);
-
-        // 2. Send this chunk-specific model matrix to the shader.
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        // a face group can only be seen from the side of the chunk's box it
+        // points to, e.g. no +x face is visible with the eye below min.x
+        bool facing[6] = {
+            eye.x > min.x, eye.x < max.x,
+            eye.y > min.y, eye.y < max.y,
+            eye.z > min.z, eye.z < max.z,
+        };
+
+        GLuint instance = draw_offsets.size();
+        if (multi_draw) draw_offsets.push_back(min);
+        else glVertexAttrib3fv(1, glm::value_ptr(min));
+
+        // one draw per run of neighbouring groups that face the eye
+        GLint base_vertex = arena.base_vertex(chunk.range);
+        GLuint quads = 0;
+        for (int face = 0; face <= 6; face++) {
+            if (face < 6 && facing[face]) {
+                quads += chunk.face_quads[face];
+                continue;
+            }
+            if (quads) {
+                if (multi_draw) {
+                    draw_commands.push_back({quads * 6, 1, 0, base_vertex, instance});
+                } else {
+                    glDrawElementsBaseVertex(GL_TRIANGLES, quads * 6, GL_UNSIGNED_INT, (void*)0, base_vertex);
+                }
+            }
+            if (face < 6) base_vertex += (quads + chunk.face_quads[face]) * 4;
+            quads = 0;
+        }
+    }
 
-        glBindVertexArray(data->vao);
-        glDrawArrays(GL_TRIANGLES, 0, data->vertices.size() / 3);
+    // all visible chunks in one call
+    if (multi_draw && !draw_commands.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, draw_offset_buffer);
+        glBufferData(GL_ARRAY_BUFFER, draw_offsets.size() * sizeof(draw_offsets[0]), draw_offsets.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_command_buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, draw_commands.size() * sizeof(draw_commands[0]), draw_commands.data(), GL_STREAM_DRAW);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, draw_commands.size(), 0);
     }
     // std::cout << "chunks drawn: " << chunksDrawn << std::endl;
 }
@@ -162,46 +319,144 @@ unsigned int texture;
 
 std::atomic<int> tasks_in_flight{0};
 
-std::unordered_set<glm::ivec3, IVec3Hash> m_pending_generation;
+struct chunk_job {
+    glm::ivec3 pos;
+    f32 max_error;
+    float priority; // lower goes first
+};
+
+// guards the queue, the running jobs and the worker count
 std::mutex m_pending_mutex;
+// waiting for a worker, best last
+std::vector<chunk_job> job_queue;
+// taken by a worker and not yet through process_finished_mesh
+chunk_set m_pending_generation;
+// tasks draining job_queue
+int workers = 0;
+
+// wanted_region::pack of the region required this frame
+std::atomic<uint64_t> wanted{0};
+
+// render thread's view of the region, kept by update_region
+glm::ivec3 region_center;
+bool region_valid = false;
+// chunks in the region that are missing or coarser than they need to be
+chunk_set to_generate;
+
+// coarse noise is fine far enough from the camera
+f32 needed_error (glm::ivec3 pos) const {
+    glm::ivec3 d = glm::abs(pos - region_center);
+    return std::max(d.x, std::max(d.y, d.z)) >= COARSE_NOISE_DISTANCE ? COARSE_NOISE_MAX_ERROR : 0;
+}
 
 // final info passed to GPU
-std::unordered_map<glm::ivec3, std::unique_ptr<chunkData>, IVec3Hash> active_chunks;
+chunk_window active_chunks{2 * wanted_region::radius + 1};
 
 tbb::task_group task_group;
 tbb::concurrent_queue<chunkData> finished_mesh_queue;   
 
-void set_vao_vbo (chunkData& mesh) {
-    glGenVertexArrays(1, &mesh.vao);
-    glBindVertexArray(mesh.vao);
-
-    glGenBuffers(1, &mesh.vbo_pos);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo_pos);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(mesh.vertices[0]), &mesh.vertices[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glGenBuffers(1, &mesh.vbo_norm);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo_norm);
-    glBufferData(GL_ARRAY_BUFFER, mesh.normals.size() * sizeof(mesh.normals[0]), &mesh.normals[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-
-    glGenBuffers(1, &mesh.vbo_tex);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo_tex);
-    glBufferData(GL_ARRAY_BUFFER, mesh.textures.size() * sizeof(mesh.textures[0]), &mesh.textures[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(2);
+upload_ring upload;
+mesh_arena arena;
+
+// glMultiDrawElementsIndirect's command layout
+struct draw_elements_command {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// GL 4.3, otherwise one glDrawElementsBaseVertex per chunk
+bool multi_draw = false;
+GLuint draw_command_buffer = 0;
+GLuint draw_offset_buffer = 0;
+// rebuilt every frame from the visible chunks, kept for their capacity
+std::vector<draw_elements_command> draw_commands;
+std::vector<glm::vec3> draw_offsets;
+
+// generator_helper::quad_indices repeated for quad_ebo_quads quads, the arena VAO's element buffer
+unsigned int quad_ebo = 0;
+size_t quad_ebo_quads = 0;
+
+// grows the shared index buffer to cover `quads` quads. it keeps its name,
+// so the arena VAO keeps pointing at it
+void reserve_quad_indices (size_t quads) {
+    if (quads <= quad_ebo_quads) return;
+
+    size_t count = std::max<size_t>(quad_ebo_quads * 2, 4096);
+    while (count < quads) count *= 2;
+
+    std::vector<uint32_t> indices(count * 6);
+    for (size_t q = 0; q < count; q++)
+        for (int i = 0; i < 6; i++)
+            indices[q * 6 + i] = q * 4 + generator_helper::quad_indices[i];
+
+    if (quad_ebo == 0) glGenBuffers(1, &quad_ebo);
+    // uploaded through GL_ARRAY_BUFFER, binding GL_ELEMENT_ARRAY_BUFFER would touch the bound VAO
+    glBindBuffer(GL_ARRAY_BUFFER, quad_ebo);
+    glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), indices.data(), GL_STATIC_DRAW);
+    quad_ebo_quads = count;
 }
 
-void calculate_mesh (chunkData& chunk) {
-    generator_helper::calculate_mesh(chunk);
+// a range of the mesh arena for the chunk, filled by a copy out of the upload ring
+void upload_mesh (chunkData& mesh) {
+    if (mesh.vertexCount == 0) {
+        generator_helper::scratch_pool.release_vertices(std::move(mesh.vertices));
+        return;
+    }
+    reserve_quad_indices(mesh.vertexCount / 4);
+
+    mesh.range = arena.allocate(mesh.vertexCount / 4);
+    size_t bytes = mesh.vertexCount * sizeof(uint32_t);
+
+    if (mesh.staged.id != 0) {
+        upload.copy(mesh.staged, arena.get_buffer(), arena.byte_offset(mesh.range));
+    } else {
+        upload.upload(mesh.vertices.data(), bytes, arena.get_buffer(), arena.byte_offset(mesh.range));
+        // the GPU has its copy, the vector goes back for the next chunk job
+        generator_helper::scratch_pool.release_vertices(std::move(mesh.vertices));
+    }
+}
+
+// one worker task, takes jobs until the queue runs dry
+void run_jobs () {
+    while (true) {
+        chunk_job job;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            if (job_queue.empty()) {
+                workers--;
+                return;
+            }
+            job = job_queue.back();
+            job_queue.pop_back();
+            // the camera moved away since it was queued
+            if (!wanted_region::contains(wanted_region::unpack(wanted.load(std::memory_order_relaxed)), job.pos)) continue;
+            m_pending_generation.insert(job.pos);
+        }
+
+        tasks_in_flight.fetch_add(1, std::memory_order_relaxed);
+        generate_chunk(job.pos, job.max_error);
+        tasks_in_flight.fetch_sub(1, std::memory_order_relaxed);
+    }
 }
 
-void generate_chunk (glm::ivec3 pos) {
+void generate_chunk (glm::ivec3 pos, f32 max_error) {
     chunkData chunk;
     chunk.pos = pos;
-    calculate_mesh(chunk); // this is the heavy stuff
+    chunk.noise_error = max_error;
+
+    std::span<const uint32_t> vertices = generator_helper::mesh_chunk(pos, chunk.face_quads, max_error); // this is the heavy stuff
+    chunk.vertexCount = vertices.size();
+
+    // straight into the upload ring when it is mapped and has room,
+    // otherwise the render thread streams it from a vector
+    chunk.staged = upload.stage(vertices.data(), vertices.size_bytes());
+    if (chunk.staged.id == 0) {
+        chunk.vertices = generator_helper::scratch_pool.acquire_vertices();
+        chunk.vertices.assign(vertices.begin(), vertices.end());
+    }
     finished_mesh_queue.push(std::move(chunk));
 }
 
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <vector>
+
+// how long each render pass of a frame takes, on the GPU (a GL_TIME_ELAPSED
+// query around it) and on the CPU (issuing its commands).
+//
+// each pass cycles through a ring of kFrames queries. results are only read
+// once GL_QUERY_RESULT_AVAILABLE says so, never waited for: the GPU numbers
+// lag a few frames, and if the GPU is so far behind that a pass's next query
+// is still in flight, that pass goes untimed on the GPU for the frame. samples
+// never written (start up, skipped frames) are left out of the averages.
+// time queries can't nest, so passes must not overlap
+class gpu_timer {
+public:
+
+    static const int kHistory = 120; // frames kept for the plots
+
+    // render thread, with the context current
+    void init (int passes) {
+        this->passes.resize(passes);
+        for (pass& p : this->passes)
+            glGenQueries(kFrames, p.queries);
+    }
+
+    // render thread, with the context still current, before it's destroyed
+    void destroy () {
+        for (pass& p : passes)
+            glDeleteQueries(kFrames, p.queries);
+        passes.clear();
+    }
+
+    void begin (int id) {
+        pass& p = passes[id];
+        collect(p);
+        p.gpu_written[cursor] = false;
+        p.cpu_written[cursor] = false;
+        p.timing = !p.pending[frame];
+        if (p.timing) glBeginQuery(GL_TIME_ELAPSED, p.queries[frame]);
+        p.cpu_start = std::chrono::high_resolution_clock::now();
+    }
+
+    void end (int id) {
+        pass& p = passes[id];
+        std::chrono::duration<float, std::milli> cpu = std::chrono::high_resolution_clock::now() - p.cpu_start;
+        if (p.timing) {
+            glEndQuery(GL_TIME_ELAPSED);
+            p.pending[frame] = true;
+            p.sample[frame] = cursor;
+        }
+        p.cpu_ms[cursor] = cpu.count();
+        p.cpu_written[cursor] = true;
+    }
+
+    // after the last pass, before swapping
+    void end_frame () {
+        frame = (frame + 1) % kFrames;
+        cursor = (cursor + 1) % kHistory;
+    }
+
+    // rolling histories in ms, oldest sample at history_offset()
+    const float* gpu_history (int id) const { return passes[id].gpu_ms; }
+    const float* cpu_history (int id) const { return passes[id].cpu_ms; }
+    int history_offset () const { return cursor; }
+
+    // over the samples written so far, 0 before the first one
+    float gpu_average (int id) const { return average(passes[id].gpu_ms, passes[id].gpu_written); }
+    float cpu_average (int id) const { return average(passes[id].cpu_ms, passes[id].cpu_written); }
+
+private:
+
+    static const int kFrames = 4;
+
+    struct pass {
+        GLuint queries[kFrames] = {};
+        bool pending[kFrames] = {};
+        int sample[kFrames] = {};     // history slot the query's result goes to
+        bool timing = false;          // this frame's query was started
+        float gpu_ms[kHistory] = {};
+        float cpu_ms[kHistory] = {};
+        bool gpu_written[kHistory] = {};
+        bool cpu_written[kHistory] = {};
+        std::chrono::high_resolution_clock::time_point cpu_start;
+    };
+
+    std::vector<pass> passes;
+    int frame = 0;   // query slot written this frame
+    int cursor = 0;  // history sample written this frame
+
+    // every result of the pass that's ready by now
+    void collect (pass& p) {
+        for (int q = 0; q < kFrames; q++) {
+            if (!p.pending[q]) continue;
+            GLint available = 0;
+            glGetQueryObjectiv(p.queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) continue;
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(p.queries[q], GL_QUERY_RESULT, &ns);
+            p.pending[q] = false;
+            p.gpu_ms[p.sample[q]] = ns / 1e6f;
+            p.gpu_written[p.sample[q]] = true;
+        }
+    }
+
+    static float average (const float* history, const bool* written) {
+        float sum = 0;
+        int count = 0;
+        for (int i = 0; i < kHistory; i++) {
+            if (!written[i]) continue;
+            sum += history[i];
+            count++;
+        }
+        return count ? sum / count : 0;
+    }
+};
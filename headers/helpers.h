@@ -14,39 +14,45 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <bit>
+#include <span>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/concurrent_queue.h>
 #include "camera.h"
+#include "upload_ring.h"
+#include "chunk_set.h"
 
-#include "../extern/perlin/perlin_sse.h"
+#include "../extern/perlin/perlin.h"
 
 int speed_index = 0;
 std::vector<float> speeds = {50,100,500};
 #define CHUNK_LENGTH 32
 #define PERLIN_THRESHOLD 160
+// the same cut on [-1,1] density, the uint8 kernels store floor((n+1)*127.5)
+#define PERLIN_DENSITY_THRESHOLD (PERLIN_THRESHOLD / 127.5f - 1.0f)
+// chunks at least this many chunks away from the camera get their density
+// from coarse noise, trilinearly upsampled (see perlinNoiseVolumeCoarse)
+#define COARSE_NOISE_DISTANCE 6
+#define COARSE_NOISE_MAX_ERROR 0.08f
+// staging buffer finished meshes are copied out of (see upload_ring.h)
+#define UPLOAD_RING_SIZE (8 * 1024 * 1024)
+// starting size of the vertex buffer all chunk meshes share (see mesh_arena.h), grows as needed
+#define MESH_ARENA_SIZE (32 * 1024 * 1024)
 
 struct chunkData {
-    uint vao = 0;
-    uint vbo_pos = 0;
-    uint vbo_norm = 0;
-    uint vbo_tex = 0;
+    uint32_t range = 0; // its mesh in the generator's mesh_arena, 0 for none
     int vertexCount = 0;
+    uint32_t face_quads[6] = {}; // quads per face id (see pack_vertex), the mesh holds them in that order
     glm::ivec3 pos;
-    std::vector<float> vertices, normals, textures;
-
-    ~chunkData() {
-        if (vao != 0) {
-            glDeleteVertexArrays(1, &vao);
-            GLuint buffers_to_delete[] = { vbo_pos, vbo_norm, vbo_tex };
-            glDeleteBuffers(3, buffers_to_delete);
-        }
-    }
+    float noise_error = 0; // max density error it was generated with, 0 for full rate noise
+    std::vector<uint32_t> vertices; // packed, see generator_helper::pack_vertex
+    staged_span staged; // or the vertices already wait in the upload ring
 };
 
+// for std containers, the same hash chunk_set uses
 struct IVec3Hash {
-    ssize_t operator()(const glm::ivec3& v) const {
-        ssize_t h1 = std::hash<int>{}(v.x);
-        ssize_t h2 = std::hash<int>{}(v.y);
-        ssize_t h3 = std::hash<int>{}(v.z);
-        return h1 ^ (h2 << 1) ^ (h3 << 2);
+    size_t operator()(const glm::ivec3& v) const {
+        return chunk_set::hash(v);
     }
 };
 
@@ -104,758 +110,233 @@ namespace render_helper {
 
 namespace generator_helper {
 
-    float len_x = 1.0/64.0; // textures are 16x16
-    float len_y = 1.0/32.0; // textures are 16x16
     float off = 0.5;
 
-    void genTopFaceSexy(float x, float y, float z, float lenx, float leny, float lenz, int tex_row, int tex_col, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& textures) {
-        std::vector<float> v = {
-            // Top Face
-            x,      y+leny, z, 
-            x+lenx, y+leny, z, 
-            x+lenx, y+leny, z+lenz, 
-            x+lenx, y+leny, z+lenz, 
-            x,      y+leny, z+lenz, 
-            x,      y+leny, z, 
-        };
-        std::vector<float> n = {
-            0.0f,  1.0f,  0.0f,
-            0.0f,  1.0f,  0.0f,
-            0.0f,  1.0f,  0.0f,
-            0.0f,  1.0f,  0.0f,
-            0.0f,  1.0f,  0.0f,
-            0.0f,  1.0f,  0.0f
-        };
-
-        float u0 = tex_col * len_x; // Left edge (u)
-        float v0 = tex_row * len_y; // Bottom edge (v)
-        float u1 = u0 + len_x;      // Right edge (u)
-        float v1 = v0 + len_y;      // Top edge (v)
-
-        std::vector<float> t = {
-            // Tri 1
-            u1, v0, // Corresponds to vertex 1 (bottom-left)
-            u0, v0, // Corresponds to vertex 2 (bottom-right)
-            u0, v1, // Corresponds to vertex 3 (top-right)
-            // Tri 2
-            u0, v1, // Corresponds to vertex 4 (top-right)
-            u1, v1, // Corresponds to vertex 5 (top-left)
-            u1, v0, // Corresponds to vertex 6 (bottom-left)
-        };
-
-
-        vertices.insert(vertices.end(), v.begin(), v.end());
-        normals.insert (normals.end(),  n.begin(), n.end());
-        textures.insert(textures.end(), t.begin(), t.end());
-    }
-
-    void genBotFaceSexy(float x, float y, float z, float lenx, float leny, float lenz, int tex_row, int tex_col, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& textures) {
-        std::vector<float> v = {
-            // Bottom Face
-            x,   y, z, 
-            x+lenx, y, z, 
-            x+lenx, y, z+lenz, 
-            x+lenx, y, z+lenz, 
-            x,   y, z+lenz, 
-            x,   y, z, 
-        };
-
-        std::vector<float> n = {
-            0.0f, -1.0f,  0.0f,
-            0.0f, -1.0f,  0.0f,
-            0.0f, -1.0f,  0.0f,
-            0.0f, -1.0f,  0.0f,
-            0.0f, -1.0f,  0.0f,
-            0.0f, -1.0f,  0.0f,
-        };
-
-        float u0 = tex_col * len_x; // Left edge (u)
-        float v0 = tex_row * len_y; // Bottom edge (v)
-        float u1 = u0 + len_x;      // Right edge (u)
-        float v1 = v0 + len_y;      // Top edge (v)
-
-        std::vector<float> t = {
-            // Tri 1
-            u0, v0, // Corresponds to vertex 1 (bottom-left)
-            u1, v0, // Corresponds to vertex 2 (bottom-right)
-            u1, v1, // Corresponds to vertex 3 (top-right)
-            // Tri 2
-            u1, v1, // Corresponds to vertex 4 (top-right)
-            u0, v1, // Corresponds to vertex 5 (top-left)
-            u0, v0, // Corresponds to vertex 6 (bottom-left)
-        };
-
-        vertices.insert(vertices.end(), v.begin(), v.end());
-        normals.insert (normals.end(),  n.begin(), n.end());
-        textures.insert(textures.end(), t.begin(), t.end());
-    }
-
-    void genLeftFaceSexy(float x, float y, float z, float lenx, float leny, float lenz, int tex_row, int tex_col, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& textures) {
-        std::vector<float> v = {
-            // Left Face
-            x,  y+leny, z+lenz, 
-            x,  y+leny, z, 
-            x,  y,   z, 
-            x,  y,   z, 
-            x,  y,   z+lenz, 
-            x,  y+leny, z+lenz, 
-        };
-
-        std::vector<float> n = {
-           -1.0f,  0.0f,  0.0f,
-           -1.0f,  0.0f,  0.0f,
-           -1.0f,  0.0f,  0.0f,
-           -1.0f,  0.0f,  0.0f,
-           -1.0f,  0.0f,  0.0f,
-           -1.0f,  0.0f,  0.0f,
-        };
-
-        float u0 = tex_col * len_x; // Left edge (u)
-        float v0 = tex_row * len_y; // Bottom edge (v)
-        float u1 = u0 + len_x;      // Right edge (u)
-        float v1 = v0 + len_y;      // Top edge (v)
-
-        std::vector<float> t = {
-            // Tri 1
-            u0, v1, // Corresponds to vertex 1 (bottom-left)
-            u1, v1, // Corresponds to vertex 2 (bottom-right)
-            u1, v0, // Corresponds to vertex 3 (top-right)
-            // Tri 2
-            u1, v0, // Corresponds to vertex 4 (top-right)
-            u0, v0, // Corresponds to vertex 5 (top-left)
-            u0, v1, // Corresponds to vertex 6 (bottom-left)
-        };
-
-        vertices.insert(vertices.end(), v.begin(), v.end());
-        normals.insert (normals.end(),  n.begin(), n.end());
-        textures.insert(textures.end(), t.begin(), t.end());
-    }
-
-    void genRightFaceSexy(float x, float y, float z, float lenx, float leny, float lenz, int tex_row, int tex_col, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& textures) {
-        std::vector<float> v = {
-            // Right Face
-            x+lenx, y+leny, z+lenz, 
-            x+lenx, y+leny, z, 
-            x+lenx, y,   z, 
-            x+lenx, y,   z, 
-            x+lenx, y,   z+lenz, 
-            x+lenx, y+leny, z+lenz, 
-        };
-
-        std::vector<float> n = {
-            1.0f,  0.0f,  0.0f,
-            1.0f,  0.0f,  0.0f,
-            1.0f,  0.0f,  0.0f,
-            1.0f,  0.0f,  0.0f,
-            1.0f,  0.0f,  0.0f,
-            1.0f,  0.0f,  0.0f,
-        };
-
-        float u0 = tex_col * len_x; // Left edge (u)
-        float v0 = tex_row * len_y; // Bottom edge (v)
-        float u1 = u0 + len_x;      // Right edge (u)
-        float v1 = v0 + len_y;      // Top edge (v)
-
-        // grows downwards
-        std::vector<float> t = {
-            u0, v1, 
-            u1, v1,
-            u1, v0,
-
-            u1, v0,
-            u0, v0,
-            u0, v1,
-        };
-        vertices.insert(vertices.end(), v.begin(), v.end());
-        normals.insert (normals.end(),  n.begin(), n.end());
-        textures.insert(textures.end(), t.begin(), t.end());
-    }
-
-    void genFrontFaceSexy(float x, float y, float z, float lenx, float leny, float lenz, int tex_row, int tex_col, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& textures) {
-        std::vector<float> v = {
-            // Front Face
-            x,   y,   z+lenz,
-            x+lenx, y,   z+lenz,
-            x+lenx, y+leny, z+lenz,
-            x+lenx, y+leny, z+lenz,
-            x,   y+leny, z+lenz,
-            x,   y,   z+lenz
-        };
-
-        std::vector<float> n = {
-            0.0f,  0.0f,  1.0f,
-            0.0f,  0.0f,  1.0f,
-            0.0f,  0.0f,  1.0f,
-            0.0f,  0.0f,  1.0f,
-            0.0f,  0.0f,  1.0f,
-            0.0f,  0.0f,  1.0f,
-        };
-
-        float u0 = tex_col * len_x; // Left edge (u)
-        float v0 = tex_row * len_y; // Bottom edge (v)
-        float u1 = u0 + len_x;      // Right edge (u)
-        float v1 = v0 + len_y;      // Top edge (v)
-
-        std::vector<float> t = {
-            // Tri 1
-            u0, v0, // Corresponds to vertex 1 (bottom-left)
-            u1, v0, // Corresponds to vertex 2 (bottom-right)
-            u1, v1, // Corresponds to vertex 3 (top-right)
-            // Tri 2
-            u1, v1, // Corresponds to vertex 4 (top-right)
-            u0, v1, // Corresponds to vertex 5 (top-left)
-            u0, v0, // Corresponds to vertex 6 (bottom-left)
-        };
-        vertices.insert(vertices.end(), v.begin(), v.end());
-        normals.insert (normals.end(),  n.begin(), n.end());
-        textures.insert(textures.end(), t.begin(), t.end());
+    // the 4 corners of a face in (u, v), drawn as two triangles by quad_indices
+    constexpr uint8_t quad_corners[4][2] = {{0,0}, {1,0}, {1,1}, {0,1}};
+    constexpr uint32_t quad_indices[6] = {0, 1, 2, 2, 3, 0};
+
+    // face directions: normal along Axis (0 x, 1 y, 2 z), Sign +1 or -1.
+    // U runs along the bits of a face plane, V along its rows
+    template <int Axis>
+    struct face_axes {
+        static constexpr int U = Axis == 0 ? 2 : 0;
+        static constexpr int V = Axis == 1 ? 2 : 1;
+    };
+
+    // one chunk vertex in 32 bits, decoded in shaders/vertex.glsl:
+    // bits 0-17   position, 6 bits per axis (0..32 within the chunk)
+    // bits 18-20  face, axis * 2 + 1 when it looks along -axis
+    // bits 21-31  atlas tile, row * 64 + column
+    // the uv corner is not stored, the shader takes it from the vertex's
+    // place in its quad (gl_VertexID % 4) with the same tables as genFace
+    inline uint32_t pack_vertex (uint32_t x, uint32_t y, uint32_t z, uint32_t face, uint32_t tile) {
+        return x | (y << 6) | (z << 12) | (face << 18) | (tile << 21);
     }
 
-    void genBackFaceSexy(float x, float y, float z, float lenx, float leny, float lenz, int tex_row, int tex_col, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& textures) {
-    
-        std::vector<float> v = {
-            // Back Face
-            x,   y,   z,
-            x+lenx, y,   z,
-            x+lenx, y+leny, z,
-            x+lenx, y+leny, z,
-            x,   y+leny, z,
-            x,   y,   z
-        };
-
-        std::vector<float> n = {
-            0.0f,  0.0f, -1.0f,
-            0.0f,  0.0f, -1.0f,
-            0.0f,  0.0f, -1.0f,
-            0.0f,  0.0f, -1.0f,
-            0.0f,  0.0f, -1.0f,
-            0.0f,  0.0f, -1.0f,
-        };
-
-        float u0 = tex_col * len_x; // Left edge (u)
-        float v0 = tex_row * len_y; // Bottom edge (v)
-        float u1 = u0 + len_x;      // Right edge (u)
-        float v1 = v0 + len_y;      // Top edge (v)
-
-        std::vector<float> t = {
-            // Tri 1
-            u0, v0, // Corresponds to vertex 1 (bottom-left)
-            u1, v0, // Corresponds to vertex 2 (bottom-right)
-            u1, v1, // Corresponds to vertex 3 (top-right)
-            // Tri 2
-            u1, v1, // Corresponds to vertex 4 (top-right)
-            u0, v1, // Corresponds to vertex 5 (top-left)
-            u0, v0, // Corresponds to vertex 6 (bottom-left)
-        };
-        vertices.insert(vertices.end(), v.begin(), v.end());
-        normals.insert (normals.end(),  n.begin(), n.end());
-        textures.insert(textures.end(), t.begin(), t.end());
-    }
-
-    void calculate_required_chunks(std::unordered_set<glm::ivec3, IVec3Hash>& current_required_chunks) {
-
-        int camera_chunk_x = static_cast<int>(floor(cameraPos.x / CHUNK_LENGTH));
-        int camera_chunk_y = static_cast<int>(floor(cameraPos.y / CHUNK_LENGTH));
-        int camera_chunk_z = static_cast<int>(floor(cameraPos.z / CHUNK_LENGTH));
-
-        for (int k=-ceil(RENDER_DISTANCE/2); k <= ceil(RENDER_DISTANCE/2); k++) { // y
-            for (int r=0; r <= ceil(RENDER_DISTANCE/2); r++) { // z
-                for (int i=0; i <= 2*r; i++)
-                    current_required_chunks.insert({camera_chunk_x - r + i, camera_chunk_y + k, camera_chunk_z - r});
-
-                for (int i=0; i <= 2*r; i++)
-                    current_required_chunks.insert({camera_chunk_x - r, camera_chunk_y + k, camera_chunk_z - r + i});
-
-                for (int i=0; i < 2*r; i++)
-                    current_required_chunks.insert({camera_chunk_x + r, camera_chunk_y + k, camera_chunk_z + r - i});
-
-                for (int i=0; i < 2*r; i++)
-                    current_required_chunks.insert({camera_chunk_x + r - i, camera_chunk_y + k, camera_chunk_z + r});
-            }
+    // the box at pos with size len, only its face facing Sign along Axis.
+    // writes its 4 vertices to out
+    template <int Axis, int Sign>
+    void genFace(const int pos[3], const int len[3], int tex_row, int tex_col, uint32_t* out) {
+        constexpr int U = face_axes<Axis>::U;
+        constexpr int V = face_axes<Axis>::V;
+        // x faces start the quad at the far corner
+        constexpr bool flip_corner = Axis == 0;
+        constexpr uint32_t face = Axis * 2 + (Sign < 0);
+
+        uint32_t tile = tex_row * 64 + tex_col;
+        int plane = Sign > 0 ? pos[Axis] + len[Axis] : pos[Axis];
+
+        for (int i = 0; i < 4; i++) {
+            bool cu = quad_corners[i][0] != flip_corner;
+            bool cv = quad_corners[i][1] != flip_corner;
+
+            int p[3];
+            p[Axis] = plane;
+            p[U] = cu ? pos[U] + len[U] : pos[U];
+            p[V] = cv ? pos[V] + len[V] : pos[V];
+            out[i] = pack_vertex(p[0], p[1], p[2], face, tile);
         }
     }
 
-    void calculate_mesh (chunkData& chunk) {
-
-        int chunk_len_2 = CHUNK_LENGTH+2;
-        std::vector<bool> arr (chunk_len_2 * chunk_len_2  * chunk_len_2 , 0);
-
-        auto is_filled = [&arr, chunk_len_2](uint8_t x, uint8_t y, uint8_t z) {
-            return arr[z * chunk_len_2 * chunk_len_2 + y * chunk_len_2 + x] == 1;
-        };
-
-        f32 f = 1.0f / 32.0f; // the smaller the more coarse
-        uint8_t* val = (uint8_t*) malloc(4 * sizeof(uint8_t));
-
-        for (int z=0; z < chunk_len_2; z++) {
-            for (int y=0; y < chunk_len_2; y++) {
-                for (int x=0; x < chunk_len_2; x += 4) {
-
-                    perlinNoiseSIMD_4x(((x-1) + chunk.pos.x * CHUNK_LENGTH + 10000) * f, ((y-1) + chunk.pos.y * CHUNK_LENGTH + 10000) * f, ((z-1) + chunk.pos.z * CHUNK_LENGTH + 10000) * f, f, val);
-                    
-                    for (int i = 0; i < 4; i++) {
-                        if (x+i >= chunk_len_2) break; // were done here
-                        if (val[i] >= PERLIN_THRESHOLD)
-                            arr[z * chunk_len_2 * chunk_len_2 + y * chunk_len_2 + x+i] = 1;
-                    }
+    // greedy merge of one 32x32 face plane: bit b of plane[r] is a face at
+    // (b, r). runs of bits become the quad width (ctz), then the quad grows
+    // over the following rows while they hold the same run. emit(b, r, w, h)
+    template <typename Emit>
+    void greedy_plane (uint32_t plane[CHUNK_LENGTH], Emit emit) {
+        for (int r = 0; r < CHUNK_LENGTH; r++) {
+            while (plane[r]) {
+                int b = std::countr_zero(plane[r]);
+                int w = std::countr_zero(~((uint64_t)plane[r] >> b));
+                uint32_t run = (uint32_t)(((1ull << w) - 1) << b);
+
+                plane[r] &= ~run;
+                int h = 1;
+                while (r + h < CHUNK_LENGTH && (plane[r + h] & run) == run) {
+                    plane[r + h] &= ~run;
+                    h++;
                 }
+                emit(b, r, w, h);
             }
         }
+    }
 
-        int tex_row = 13-1;
-        int tex_col = 15-1;
-
-        // for (int z=1; z <= CHUNK_LENGTH; z++) {
-        //     for (int y=1; y <= CHUNK_LENGTH; y++) {
-        //         for (int x=1; x <= CHUNK_LENGTH; x++) {
-        //             if (!is_filled(x,y,z)) continue;
-                    // if (!is_filled(x+1,y,z)) 
-                    //     genRightFace (x-1,y-1,z-1,1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                    // if (!is_filled(x-1,y,z))
-                    //     genLeftFace  (x-1,y-1,z-1,1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                    // // if (!is_filled(x,y+1,z))
-                    //     genTopFace   (x-1,y-1,z-1,1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                    // if (!is_filled(x,y-1,z))
-                    //     genBotFace   (x-1,y-1,z-1,1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                    // if (!is_filled(x,y,z+1))
-                    //     genFrontFace (x-1,y-1,z-1,1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                    // if (!is_filled(x,y,z-1))
-                    //     genBackFace  (x-1,y-1,z-1,1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-        //         }
-        //     }
-        // }
-
-
-        for (int y=1; y <= CHUNK_LENGTH; y++) {
-
-            std::vector<bool> top_faces_occ (CHUNK_LENGTH * CHUNK_LENGTH, false);
-            std::vector<bool> top_faces_filled (CHUNK_LENGTH * CHUNK_LENGTH, false);
-
-            auto is_top_filled = [&top_faces_filled](int x, int z) {
-                return top_faces_filled[(x-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
-
-            auto set_top_filled = [&top_faces_filled](int x, int z) {
-                top_faces_filled[(x-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
-
-            auto set_top_occ = [&top_faces_occ](int x, int z) {
-                top_faces_occ[(x-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
-
-            auto is_top_occ = [&top_faces_occ](int x, int z) {
-                return top_faces_occ[(x-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
-
-            for (int z=1; z <= CHUNK_LENGTH; z++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    if (is_filled(x, y, z))
-                        set_top_filled(x,z);
-                }
-            }
-
-            for (int z=1; z <= CHUNK_LENGTH; z++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    // if above filled or you not filled
-                    if (is_filled(x,y+1,z) || !is_filled(x,y,z) || is_top_occ(x,z)) continue;
-
-                    int length_x = 1;
-                    int length_z = 1;
-                    bool stretch;
-                    bool skip;
-                    do {
-                        stretch = false;  
-                        if (x+length_x < CHUNK_LENGTH && z+length_z-1 < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_z; i++) {
-                                if (is_filled(x+length_x,y+1,z+i) || !is_top_filled(x+length_x,z+i) || is_top_occ(x+length_x,z+i))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_z; i++)
-                                    set_top_occ(x+length_x,z+i);    
-                                length_x++;
-                            }
-                        }
-                        if (x+length_x-1 < CHUNK_LENGTH && z+length_z < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_x; i++) {
-                                if (is_filled(x+i,y+1,z+length_z) || !is_top_filled(x+i,z+length_z) || is_top_occ(x+i,z+length_z))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_x; i++)
-                                    set_top_occ(x+i,z+length_z);
-                                length_z++;
-                            }
-                        }
-                    } while (stretch);
-
-                    genTopFaceSexy (x-1,y-1,z-1,length_x, 1, length_z,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                }
+    // 32x32 bit matrix transpose in place: bit j of m[i] <-> bit i of m[j]
+    inline void transpose_32x32 (uint32_t m[32]) {
+        uint32_t mask = 0x0000FFFF;
+        for (int j = 16; j != 0; j >>= 1, mask ^= mask << j) {
+            for (int k = 0; k < 32; k = ((k | j) + 1) & ~j) {
+                uint32_t t = ((m[k] >> j) ^ m[k | j]) & mask;
+                m[k] ^= t << j;
+                m[k | j] ^= t;
             }
         }
+    }
 
-        for (int y=1; y <= CHUNK_LENGTH; y++) {
-
-            std::vector<bool> bot_faces_occ (CHUNK_LENGTH * CHUNK_LENGTH, false);
-            std::vector<bool> bot_faces_filled (CHUNK_LENGTH * CHUNK_LENGTH, false);
-
-            auto is_bot_filled = [&bot_faces_filled](int x, int z) {
-                return bot_faces_filled[(x-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
-
-            auto set_bot_filled = [&bot_faces_filled](int x, int z) {
-                bot_faces_filled[(x-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
-
-            auto set_bot_occ = [&bot_faces_occ](int x, int z) {
-                bot_faces_occ[(x-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
-
-            auto is_bot_occ = [&bot_faces_occ](int x, int z) {
-                return bot_faces_occ[(x-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
-
-            for (int z=1; z <= CHUNK_LENGTH; z++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    if (is_filled(x, y, z))
-                        set_bot_filled(x,z);
-                }
-            }
+    // solid voxels as 32-bit rows sliced along one axis: bit b of layers[s][r]
+    // is the voxel at slice s (padded, 0..33), row r and bit b along that
+    // axis' V and U (see face_axes). rows and bits only cover the inner chunk
+    typedef uint32_t solid_layers[CHUNK_LENGTH+2][CHUNK_LENGTH];
+
+    // unmerged faces of both signs along the layers' axis, so an upper bound on their quads
+    inline size_t count_faces (const solid_layers& layers) {
+        size_t count = 0;
+        for (int s = 1; s <= CHUNK_LENGTH; s++)
+            for (int r = 0; r < CHUNK_LENGTH; r++)
+                count += std::popcount(layers[s][r] & ~layers[s-1][r])
+                       + std::popcount(layers[s][r] & ~layers[s+1][r]);
+        return count;
+    }
 
-            for (int z=1; z <= CHUNK_LENGTH; z++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    // if above filled or you not filled
-                    if (is_filled(x,y-1,z) || !is_filled(x,y,z) || is_bot_occ(x,z)) continue;
-
-                    int length_x = 1;
-                    int length_z = 1;
-                    bool stretch;
-                    bool skip;
-                    do {
-                        stretch = false;  
-                        if (x+length_x < CHUNK_LENGTH && z+length_z-1 < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_z; i++) {
-                                if (is_filled(x+length_x,y-1,z+i) || !is_bot_filled(x+length_x,z+i) || is_bot_occ(x+length_x,z+i))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_z; i++)
-                                    set_bot_occ(x+length_x,z+i);    
-                                length_x++;
-                            }
-                        }
-                        if (x+length_x-1 < CHUNK_LENGTH && z+length_z < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_x; i++) {
-                                if (is_filled(x+i,y-1,z+length_z) || !is_bot_filled(x+i,z+length_z) || is_bot_occ(x+i,z+length_z))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_x; i++)
-                                    set_bot_occ(x+i,z+length_z);
-                                length_z++;
-                            }
-                        }
-                    } while (stretch);
-
-                    genBotFaceSexy (x-1,y-1,z-1,length_x, 1, length_z,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                }
-            }
+    // every face looking along Sign on Axis: a voxel whose neighbour slice is
+    // empty there, greedily merged per slice. out advances 4 vertices per quad
+    template <int Axis, int Sign>
+    void greedy_faces (const solid_layers& layers, int tex_row, int tex_col, uint32_t*& out) {
+        constexpr int U = face_axes<Axis>::U;
+        constexpr int V = face_axes<Axis>::V;
+
+        uint32_t plane[CHUNK_LENGTH];
+        for (int s = 1; s <= CHUNK_LENGTH; s++) {
+            for (int r = 0; r < CHUNK_LENGTH; r++)
+                plane[r] = layers[s][r] & ~layers[s + Sign][r];
+
+            greedy_plane(plane, [&](int b, int r, int w, int h) {
+                int pos[3], len[3];
+                pos[Axis] = s - 1; len[Axis] = 1;
+                pos[U] = b;        len[U] = w;
+                pos[V] = r;        len[V] = h;
+                genFace<Axis, Sign>(pos, len, tex_row, tex_col, out);
+                out += 4;
+            });
         }
+    }
 
-        for (int z=1; z <= CHUNK_LENGTH; z++) {
-
-            std::vector<bool> bot_faces_occ (CHUNK_LENGTH * CHUNK_LENGTH, false);
-            std::vector<bool> bot_faces_filled (CHUNK_LENGTH * CHUNK_LENGTH, false);
-
-            auto is_bot_filled = [&bot_faces_filled](int x, int y) {
-                return bot_faces_filled[(y-1) * CHUNK_LENGTH + (x-1)] == true;
-            };
-
-            auto set_bot_filled = [&bot_faces_filled](int x, int y) {
-                bot_faces_filled[(y-1) * CHUNK_LENGTH + (x-1)] = true;
-            };
-
-            auto set_bot_occ = [&bot_faces_occ](int x, int y) {
-                bot_faces_occ[(y-1) * CHUNK_LENGTH + (x-1)] = true;
-            };
-
-            auto is_bot_occ = [&bot_faces_occ](int x, int y) {
-                return bot_faces_occ[(y-1) * CHUNK_LENGTH + (x-1)] == true;
-            };
-
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    if (is_filled(x, y, z))
-                        set_bot_filled(x,y);
-                }
-            }
-
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    // if above filled or you not filled
-                    if (is_filled(x,y,z+1) || !is_filled(x,y,z) || is_bot_occ(x,y)) continue;
-
-                    int length_x = 1;
-                    int length_y = 1;
-                    bool stretch;
-                    bool skip;
-                    do {
-                        stretch = false;  
-                        if (x+length_x < CHUNK_LENGTH && y+length_y-1 < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_y; i++) {
-                                if (is_filled(x+length_x,y+i,z+1) || !is_bot_filled(x+length_x,y+i) || is_bot_occ(x+length_x,y+i))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_y; i++)
-                                    set_bot_occ(x+length_x,y+i);    
-                                length_x++;
-                            }
-                        }
-                        if (x+length_x-1 < CHUNK_LENGTH && y+length_y < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_x; i++) {
-                                if (is_filled(x+i,y+length_y,z+1) || !is_bot_filled(x+i,y+length_y) || is_bot_occ(x+i,y+length_y))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_x; i++)
-                                    set_bot_occ(x+i,y+length_y);
-                                length_y++;
-                            }
-                        }
-                    } while (stretch);
-
-                    genFrontFaceSexy (x-1,y-1,z-1,length_x, length_y, 1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                }
-            }
+    // everything mesh_chunk works in
+    struct mesh_scratch {
+        // one bit per voxel of the padded chunk, bit x of solid[z * (CHUNK_LENGTH+2) + y]
+        uint64_t solid[(CHUNK_LENGTH+2) * (CHUNK_LENGTH+2)];
+        solid_layers layers[3];
+        // quads before the exact copy into the chunk, only ever grows
+        std::vector<uint32_t> staging;
+    };
+
+    // memory for chunk generation jobs, so a warmed up worker meshes without
+    // going to the allocator. each thread gets its own mesh_scratch the first
+    // time it asks, and chunk vertex vectors are recycled: the render thread
+    // hands them back after upload and the next job reuses their capacity
+    class mesh_scratch_pool {
+    public:
+        mesh_scratch_pool () { free_vertices.set_capacity(kMaxSpareVertices); }
+
+        // the calling thread's scratch
+        mesh_scratch& local () { return workers.local(); }
+
+        // an empty vector, with capacity if one was released before
+        std::vector<uint32_t> acquire_vertices () {
+            std::vector<uint32_t> v;
+            free_vertices.try_pop(v);
+            return v;
         }
 
-        for (int z=1; z <= CHUNK_LENGTH; z++) {
-
-            std::vector<bool> bot_faces_occ (CHUNK_LENGTH * CHUNK_LENGTH, false);
-            std::vector<bool> bot_faces_filled (CHUNK_LENGTH * CHUNK_LENGTH, false);
-
-            auto is_bot_filled = [&bot_faces_filled](int x, int y) {
-                return bot_faces_filled[(y-1) * CHUNK_LENGTH + (x-1)] == true;
-            };
-
-            auto set_bot_filled = [&bot_faces_filled](int x, int y) {
-                bot_faces_filled[(y-1) * CHUNK_LENGTH + (x-1)] = true;
-            };
-
-            auto set_bot_occ = [&bot_faces_occ](int x, int y) {
-                bot_faces_occ[(y-1) * CHUNK_LENGTH + (x-1)] = true;
-            };
-
-            auto is_bot_occ = [&bot_faces_occ](int x, int y) {
-                return bot_faces_occ[(y-1) * CHUNK_LENGTH + (x-1)] == true;
-            };
-
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    if (is_filled(x, y, z))
-                        set_bot_filled(x,y);
-                }
-            }
-
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int x=1; x <= CHUNK_LENGTH; x++) {
-                    // if above filled or you not filled
-                    if (is_filled(x,y,z-1) || !is_filled(x,y,z) || is_bot_occ(x,y)) continue;
-
-                    int length_x = 1;
-                    int length_y = 1;
-                    bool stretch;
-                    bool skip;
-                    do {
-                        stretch = false;  
-                        if (x+length_x < CHUNK_LENGTH && y+length_y-1 < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_y; i++) {
-                                if (is_filled(x+length_x,y+i,z-1) || !is_bot_filled(x+length_x,y+i) || is_bot_occ(x+length_x,y+i))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_y; i++)
-                                    set_bot_occ(x+length_x,y+i);    
-                                length_x++;
-                            }
-                        }
-                        if (x+length_x-1 < CHUNK_LENGTH && y+length_y < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_x; i++) {
-                                if (is_filled(x+i,y+length_y,z-1) || !is_bot_filled(x+i,y+length_y) || is_bot_occ(x+i,y+length_y))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_x; i++)
-                                    set_bot_occ(x+i,y+length_y);
-                                length_y++;
-                            }
-                        }
-                    } while (stretch);
-
-                    genBackFaceSexy (x-1,y-1,z-1,length_x, length_y, 1,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                }
-            }
+        // past kMaxSpareVertices spares the vector is just freed
+        void release_vertices (std::vector<uint32_t>&& v) {
+            v.clear();
+            free_vertices.try_emplace(std::move(v));
         }
-    
-        for (int x=1; x <= CHUNK_LENGTH; x++) {
-
-            std::vector<bool> top_faces_occ (CHUNK_LENGTH * CHUNK_LENGTH, false);
-            std::vector<bool> top_faces_filled (CHUNK_LENGTH * CHUNK_LENGTH, false);
-
-            auto is_top_filled = [&top_faces_filled](int y, int z) {
-                return top_faces_filled[(y-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
 
-            auto set_top_filled = [&top_faces_filled](int y, int z) {
-                top_faces_filled[(y-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
+    private:
+        static const int kMaxSpareVertices = 256;
+        tbb::enumerable_thread_specific<mesh_scratch> workers;
+        tbb::concurrent_bounded_queue<std::vector<uint32_t>> free_vertices;
+    };
 
-            auto set_top_occ = [&top_faces_occ](int y, int z) {
-                top_faces_occ[(y-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
-
-            auto is_top_occ = [&top_faces_occ](int y, int z) {
-                return top_faces_occ[(y-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
-
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int z=1; z <= CHUNK_LENGTH; z++) {
-                    if (is_filled(x, y, z))
-                        set_top_filled(y,z);
-                }
-            }
-
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int z=1; z <= CHUNK_LENGTH; z++) {
-                    // if above filled or you not filled
-                    if (is_filled(x+1,y,z) || !is_filled(x,y,z) || is_top_occ(y,z)) continue;
-
-                    int length_y = 1;
-                    int length_z = 1;
-                    bool stretch;
-                    bool skip;
-                    do {
-                        stretch = false;  
-                        if (y+length_y < CHUNK_LENGTH && z+length_z-1 < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_z; i++) {
-                                if (is_filled(x+1,y+length_y,z+i) || !is_top_filled(y+length_y,z+i) || is_top_occ(y+length_y,z+i))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_z; i++)
-                                    set_top_occ(y+length_y,z+i);    
-                                length_y++;
-                            }
-                        }
-                        if (y+length_y-1 < CHUNK_LENGTH && z+length_z < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_y; i++) {
-                                if (is_filled(x+1,y+i,z+length_z) || !is_top_filled(y+i,z+length_z) || is_top_occ(y+i,z+length_z))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_y; i++)
-                                    set_top_occ(y+i,z+length_z);
-                                length_z++;
-                            }
-                        }
-                    } while (stretch);
-
-                    genRightFaceSexy (x-1,y-1,z-1,1,length_y,length_z,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                }
-            }
-        }
+    mesh_scratch_pool scratch_pool;
 
-        for (int x=1; x <= CHUNK_LENGTH; x++) {
+    // meshes the chunk at pos into the calling thread's scratch, the vertices
+    // stay valid until the thread meshes again.
+    // max_error > 0 allows coarse noise with at most that much error in [-1,1] units.
+    // quads come out grouped by face id, face_quads gets the size of each group
+    std::span<const uint32_t> mesh_chunk (glm::ivec3 pos, uint32_t face_quads[6], f32 max_error = 0) {
 
-            std::vector<bool> top_faces_occ (CHUNK_LENGTH * CHUNK_LENGTH, false);
-            std::vector<bool> top_faces_filled (CHUNK_LENGTH * CHUNK_LENGTH, false);
+        int chunk_len_2 = CHUNK_LENGTH+2;
 
-            auto is_top_filled = [&top_faces_filled](int y, int z) {
-                return top_faces_filled[(y-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
+        mesh_scratch& scratch = scratch_pool.local();
+        uint64_t* solid = scratch.solid;
+        solid_layers* layers = scratch.layers;
 
-            auto set_top_filled = [&top_faces_filled](int y, int z) {
-                top_faces_filled[(y-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
+        f32 f = 1.0f / 32.0f; // the smaller the more coarse
+        const perlin_kernels& noise = perlin_get_kernels();
 
-            auto set_top_occ = [&top_faces_occ](int y, int z) {
-                top_faces_occ[(y-1) * CHUNK_LENGTH + (z-1)] = true;
-            };
+        // the whole padded chunk (one voxel border) in one call, thresholded in the kernel
+        u32 step = max_error > 0 ? perlin_coarse_step(f, max_error) : 1;
+        noise.perlinSolidityVolume((-1 + pos.x * CHUNK_LENGTH + 10000) * f, (-1 + pos.y * CHUNK_LENGTH + 10000) * f, (-1 + pos.z * CHUNK_LENGTH + 10000) * f,
+                                   chunk_len_2, chunk_len_2, chunk_len_2, f, step, PERLIN_DENSITY_THRESHOLD, solid);
 
-            auto is_top_occ = [&top_faces_occ](int y, int z) {
-                return top_faces_occ[(y-1) * CHUNK_LENGTH + (z-1)] == true;
-            };
+        int tex_row = 13-1;
+        int tex_col = 15-1;
 
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int z=1; z <= CHUNK_LENGTH; z++) {
-                    if (is_filled(x, y, z))
-                        set_top_filled(y,z);
-                }
+        // x slices need the rows turned over: per y, the 32x32 (z, x) block
+        // transposed gives bits z per x. the padding columns x = 0 and 33 by hand
+        for (int y = 1; y <= CHUNK_LENGTH; y++) {
+            uint32_t m[32];
+            uint32_t pad_lo = 0, pad_hi = 0;
+            for (int z = 1; z <= CHUNK_LENGTH; z++) {
+                uint64_t r = solid[z * chunk_len_2 + y];
+                m[z-1] = (uint32_t)(r >> 1);
+                pad_lo |= (uint32_t)(r & 1) << (z-1);
+                pad_hi |= (uint32_t)(r >> (CHUNK_LENGTH+1) & 1) << (z-1);
             }
-
-            for (int y=1; y <= CHUNK_LENGTH; y++) {
-                for (int z=1; z <= CHUNK_LENGTH; z++) {
-                    // if above filled or you not filled
-                    if (is_filled(x-1,y,z) || !is_filled(x,y,z) || is_top_occ(y,z)) continue;
-
-                    int length_y = 1;
-                    int length_z = 1;
-                    bool stretch;
-                    bool skip;
-                    do {
-                        stretch = false;  
-                        if (y+length_y < CHUNK_LENGTH && z+length_z-1 < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_z; i++) {
-                                if (is_filled(x-1,y+length_y,z+i) || !is_top_filled(y+length_y,z+i) || is_top_occ(y+length_y,z+i))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_z; i++)
-                                    set_top_occ(y+length_y,z+i);    
-                                length_y++;
-                            }
-                        }
-                        if (y+length_y-1 < CHUNK_LENGTH && z+length_z < CHUNK_LENGTH) {
-                            skip = false;
-                            for (int i = 0; i < length_y; i++) {
-                                if (is_filled(x-1,y+i,z+length_z) || !is_top_filled(y+i,z+length_z) || is_top_occ(y+i,z+length_z))
-                                    skip = true;
-                            }
-                            if (!skip) {
-                                stretch = true;
-                                for (int i = 0; i < length_y; i++)
-                                    set_top_occ(y+i,z+length_z);
-                                length_z++;
-                            }
-                        }
-                    } while (stretch);
-
-                    genLeftFaceSexy (x-1,y-1,z-1,1,length_y,length_z,tex_row,tex_col,chunk.vertices,chunk.normals,chunk.textures);
-                }
+            transpose_32x32(m);
+            layers[0][0][y-1] = pad_lo;
+            layers[0][CHUNK_LENGTH+1][y-1] = pad_hi;
+            for (int x = 1; x <= CHUNK_LENGTH; x++)
+                layers[0][x][y-1] = m[x-1];
+        }
+        // y slices are rows z, z slices rows y, both keep bits x
+        for (int z = 0; z < chunk_len_2; z++) {
+            for (int y = 0; y < chunk_len_2; y++) {
+                uint32_t r = (uint32_t)(solid[z * chunk_len_2 + y] >> 1);
+                if (z >= 1 && z <= CHUNK_LENGTH) layers[1][y][z-1] = r;
+                if (y >= 1 && y <= CHUNK_LENGTH) layers[2][z][y-1] = r;
             }
         }
+
+        // quads are staged for the worst case (no merging at all)
+        std::vector<uint32_t>& staging = scratch.staging;
+        size_t max_quads = count_faces(layers[0]) + count_faces(layers[1]) + count_faces(layers[2]);
+        if (staging.size() < max_quads * 4) staging.resize(max_quads * 4);
+
+        uint32_t* out = staging.data();
+        uint32_t* group[7] = {out};
+        greedy_faces<0, +1>(layers[0], tex_row, tex_col, out); group[1] = out;
+        greedy_faces<0, -1>(layers[0], tex_row, tex_col, out); group[2] = out;
+        greedy_faces<1, +1>(layers[1], tex_row, tex_col, out); group[3] = out;
+        greedy_faces<1, -1>(layers[1], tex_row, tex_col, out); group[4] = out;
+        greedy_faces<2, +1>(layers[2], tex_row, tex_col, out); group[5] = out;
+        greedy_faces<2, -1>(layers[2], tex_row, tex_col, out); group[6] = out;
+        for (int face = 0; face < 6; face++)
+            face_quads[face] = (group[face+1] - group[face]) / 4;
+
+        return std::span<const uint32_t>(staging.data(), out);
     }
-}
\ No newline at end of file
+}
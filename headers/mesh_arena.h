@@ -0,0 +1,187 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// every chunk mesh lives in one vertex buffer, drawn through one VAO with
+// glDrawElementsBaseVertex. chunks own ranges of it counted in quads (4
+// packed vertices), so base vertices stay multiples of 4 and gl_VertexID & 3
+// is still the quad corner.
+//
+// free ranges are kept merged with their neighbours and handed out best fit.
+// when nothing fits, or pruning left too many holes, the live ranges get
+// packed into a fresh buffer with GPU side copies. that moves them, so chunks
+// hold a handle and ask for their base vertex at draw time
+class mesh_arena {
+public:
+
+    // render thread, with the context current. index_buffer becomes the VAO's element buffer
+    void init (uint32_t quads, GLuint index_buffer) {
+        slots.push_back({0, 0}); // handle 0 is "no mesh"
+
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+        glBindVertexArray(0);
+
+        relocate(quads);
+    }
+
+    GLuint get_vao () const { return vao; }
+    GLuint get_buffer () const { return buffer; }
+
+    // first vertex and byte offset of a handle's range
+    GLint base_vertex (uint32_t handle) const { return slots[handle].offset * 4; }
+    size_t byte_offset (uint32_t handle) const { return (size_t)slots[handle].offset * kQuadBytes; }
+
+    // a range of `quads` quads, 0 for an empty mesh. may move every other range
+    uint32_t allocate (uint32_t quads) {
+        if (quads == 0) return 0;
+
+        auto fit = by_size.lower_bound(quads);
+        if (fit == by_size.end()) {
+            // room enough but all in holes: pack, otherwise grow (and pack)
+            uint32_t needed = used + quads;
+            relocate(needed <= capacity ? capacity : std::max(capacity * 2, needed));
+            fit = by_size.lower_bound(quads);
+        }
+
+        uint32_t offset = fit->second;
+        uint32_t size = fit->first;
+        remove_free(offset, size);
+        if (size > quads) add_free(offset + quads, size - quads);
+
+        uint32_t handle;
+        if (!free_handles.empty()) {
+            handle = free_handles.back();
+            free_handles.pop_back();
+        } else {
+            handle = slots.size();
+            slots.push_back({});
+        }
+        slots[handle] = {offset, quads};
+        used += quads;
+        return handle;
+    }
+
+    void free (uint32_t handle) {
+        if (handle == 0) return;
+        slot& s = slots[handle];
+        uint32_t offset = s.offset;
+        uint32_t size = s.quads;
+        used -= size;
+        s = {0, 0};
+        free_handles.push_back(handle);
+
+        // merge with the free neighbours
+        auto next = by_offset.lower_bound(offset);
+        if (next != by_offset.end() && next->first == offset + size) {
+            size += next->second;
+            remove_free(next->first, next->second);
+        }
+        next = by_offset.lower_bound(offset);
+        if (next != by_offset.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                size += prev->second;
+                remove_free(prev->first, prev->second);
+            }
+        }
+        add_free(offset, size);
+    }
+
+    // after pruning. packs the ranges once holes below the last live range
+    // are over a quarter of it (and worth a copy)
+    void maybe_compact () {
+        uint32_t end = capacity;
+        if (!by_offset.empty()) {
+            auto last = std::prev(by_offset.end());
+            if (last->first + last->second == capacity) end = last->first;
+        }
+        uint32_t holes = end - used;
+        if (holes > kMinCompactQuads && holes * 4 > end) relocate(capacity);
+    }
+
+private:
+
+    static const uint32_t kQuadBytes = 4 * sizeof(uint32_t);
+    static const uint32_t kMinCompactQuads = 1 << 16; // 1MB
+
+    struct slot {
+        uint32_t offset, quads;
+    };
+
+    GLuint vao = 0;
+    GLuint buffer = 0;
+    uint32_t capacity = 0;  // in quads
+    uint32_t used = 0;
+
+    std::vector<slot> slots;                        // by handle
+    std::vector<uint32_t> free_handles;
+    std::map<uint32_t, uint32_t> by_offset;         // free ranges, offset -> quads
+    std::multimap<uint32_t, uint32_t> by_size;      // the same ranges, quads -> offset
+
+    void add_free (uint32_t offset, uint32_t size) {
+        by_offset[offset] = size;
+        by_size.insert({size, offset});
+    }
+
+    void remove_free (uint32_t offset, uint32_t size) {
+        by_offset.erase(offset);
+        auto range = by_size.equal_range(size);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == offset) {
+                by_size.erase(it);
+                break;
+            }
+        }
+    }
+
+    // a new buffer of new_capacity quads with every live range packed at its
+    // start, in their old order. runs that were already adjacent move in one copy
+    void relocate (uint32_t new_capacity) {
+        GLuint fresh;
+        glGenBuffers(1, &fresh);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, fresh);
+        glBufferData(GL_COPY_WRITE_BUFFER, (size_t)new_capacity * kQuadBytes, nullptr, GL_STATIC_DRAW);
+
+        std::vector<uint32_t> live;
+        for (uint32_t h = 1; h < slots.size(); h++)
+            if (slots[h].quads) live.push_back(h);
+        std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b) { return slots[a].offset < slots[b].offset; });
+
+        if (buffer) glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        uint32_t packed = 0;
+        for (size_t i = 0; i < live.size();) {
+            uint32_t src = slots[live[i]].offset;
+            uint32_t dst = packed;
+            uint32_t run = 0;
+            for (; i < live.size() && slots[live[i]].offset == src + run; i++) {
+                slots[live[i]].offset = dst + run;
+                run += slots[live[i]].quads;
+            }
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (size_t)src * kQuadBytes, (size_t)dst * kQuadBytes, (size_t)run * kQuadBytes);
+            packed += run;
+        }
+
+        if (buffer) glDeleteBuffers(1, &buffer);
+        buffer = fresh;
+        capacity = new_capacity;
+
+        by_offset.clear();
+        by_size.clear();
+        if (packed < capacity) add_free(packed, capacity - packed);
+
+        // one uint per vertex, see generator_helper::pack_vertex
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+};
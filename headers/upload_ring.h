@@ -0,0 +1,185 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+// one chunk's vertices sitting in the upload ring, id 0 when nothing is staged
+struct staged_span {
+    uint64_t id = 0;
+    size_t offset = 0;
+    size_t bytes = 0;
+};
+
+// streaming buffer chunk meshes pass through on their way to the GPU.
+//
+// with GL 4.4 it is persistently mapped and worker threads copy their quads
+// straight in (stage). on GL 3.3 only the render thread writes to it, through
+// unsynchronized maps, and the buffer gets orphaned when it runs out of room.
+// either way the render thread only issues glCopyBufferSubData, and a fence
+// behind each copy says when its bytes can be handed out again.
+//
+// space is handed out in order around the ring and freed from the oldest
+// span on, so a span whose chunk got dropped still has to be discarded
+class upload_ring {
+public:
+
+    // render thread, with the context current
+    void init (size_t bytes) {
+        capacity = bytes;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        if (GLAD_GL_VERSION_4_4) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_READ_BUFFER, capacity, nullptr, flags);
+            mapped = (uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity, flags);
+        } else {
+            glBufferData(GL_COPY_READ_BUFFER, capacity, nullptr, GL_STREAM_COPY);
+        }
+    }
+
+    // workers can stage their own quads
+    bool persistent () const { return mapped != nullptr; }
+
+    // any thread, persistent ring only. copies data in, or returns an empty
+    // span when the ring is full or not mapped
+    staged_span stage (const void* data, size_t bytes) {
+        staged_span span;
+        if (!mapped || bytes == 0) return span;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!allocate(bytes, span)) return staged_span();
+        }
+        std::memcpy(mapped + span.offset, data, bytes);
+        return span;
+    }
+
+    // render thread. copies a staged span to dst at dst_offset and fences it
+    void copy (const staged_span& span, GLuint dst, size_t dst_offset) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, span.offset, dst_offset, span.bytes);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        find(span.id).fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // render thread. a staged span that will never be copied
+    void discard (const staged_span& span) {
+        if (span.id == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        find(span.id).done = true;
+    }
+
+    // render thread. cpu memory to dst at dst_offset, through the ring
+    void upload (const void* data, size_t bytes, GLuint dst, size_t dst_offset) {
+        if (bytes == 0) return;
+
+        staged_span span;
+        if (mapped) {
+            span = stage(data, bytes);
+        } else if (bytes <= capacity) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!allocate(bytes, span)) {
+                // every pending copy keeps the old storage alive, start over on fresh storage
+                orphan();
+                allocate(bytes, span);
+            }
+            lock.unlock();
+
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            void* p = glMapBufferRange(GL_COPY_READ_BUFFER, span.offset, bytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            std::memcpy(p, data, bytes);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+
+        if (span.id != 0) {
+            copy(span, dst, dst_offset);
+        } else {
+            // persistent ring full, or bigger than the whole ring
+            glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, dst_offset, bytes, data);
+        }
+    }
+
+    // render thread, once per frame. frees spans from the oldest on, as long
+    // as they were discarded or their copy has finished on the GPU
+    void retire () {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!regions.empty()) {
+            region& r = regions.front();
+            if (r.fence) {
+                if (glClientWaitSync(r.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+                glDeleteSync(r.fence);
+            } else if (!r.done) {
+                break;
+            }
+            regions.pop_front();
+            front_id++;
+        }
+    }
+
+    ~upload_ring () {
+        for (region& r : regions)
+            if (r.fence) glDeleteSync(r.fence);
+        if (buffer) glDeleteBuffers(1, &buffer);
+    }
+
+private:
+
+    struct region {
+        size_t begin, end;
+        GLsync fence = 0;   // set once its copy is issued
+        bool done = false;  // discarded, or padding up to the end of the ring
+    };
+
+    GLuint buffer = 0;
+    size_t capacity = 0;
+    uint8_t* mapped = nullptr;   // persistent mapping, null on GL 3.3
+
+    std::mutex mutex;            // guards everything below
+    std::deque<region> regions;  // handed out and not yet freed, oldest first
+    uint64_t front_id = 1;       // id of regions.front()
+    size_t head = 0;             // where the next span starts
+
+    region& find (uint64_t id) { return regions[id - front_id]; }
+
+    // mutex held. the used part of the ring is [tail, head), or
+    // [tail, capacity) + [0, head) once it wrapped
+    bool allocate (size_t bytes, staged_span& span) {
+        if (regions.empty()) head = 0;
+        size_t tail = regions.empty() ? 0 : regions.front().begin;
+        bool wrapped = !regions.empty() && head <= tail;
+
+        if (wrapped) {
+            if (head + bytes > tail) return false;
+        } else if (head + bytes > capacity) {
+            if (bytes > tail) return false;
+            // the rest of the ring is too short, skip it
+            regions.push_back({head, capacity, 0, true});
+            head = 0;
+        }
+
+        regions.push_back({head, head + bytes});
+        span.id = front_id + regions.size() - 1;
+        span.offset = head;
+        span.bytes = bytes;
+        head += bytes;
+        return true;
+    }
+
+    // mutex held, GL 3.3 ring only
+    void orphan () {
+        for (region& r : regions)
+            if (r.fence) glDeleteSync(r.fence);
+        front_id += regions.size();
+        regions.clear();
+        head = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBufferData(GL_COPY_READ_BUFFER, capacity, nullptr, GL_STREAM_COPY);
+    }
+};
@@ -1,20 +1,45 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 inNormal;
-layout (location = 2) in vec2 aTexCoord;
+// packed chunk vertex, see generator_helper::pack_vertex
+layout (location = 0) in uint aVertex;
+// where the chunk starts in the world, one per draw
+layout (location = 1) in vec3 aChunkOffset;
 
 out vec3 faceNormal;
 out vec3 fragPos;
 out vec2 texCoord;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// face id -> normal, +x -x +y -y +z -z
+const vec3 face_normals[6] = vec3[6](
+    vec3( 1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3( 0.0, 1.0, 0.0), vec3( 0.0,-1.0, 0.0),
+    vec3( 0.0, 0.0, 1.0), vec3( 0.0, 0.0,-1.0)
+);
+
+// uv corner of the 4 vertices of a quad, same order as quad_corners in helpers.h
+const uvec2 quad_corners[4] = uvec2[4](
+    uvec2(0u,0u), uvec2(1u,0u), uvec2(1u,1u), uvec2(0u,1u)
+);
+
+// the atlas is 64 x 32 tiles of 16x16
+const vec2 tile_size = vec2(1.0 / 64.0, 1.0 / 32.0);
+
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    fragPos = (model * vec4(aPos, 1.0)).xyz;
-    faceNormal = mat3(transpose(inverse(model))) * inNormal;
-    texCoord = aTexCoord;
-}
\ No newline at end of file
+    vec3 pos = vec3(aVertex & 63u, (aVertex >> 6) & 63u, (aVertex >> 12) & 63u);
+    uint face = (aVertex >> 18) & 7u;
+    uint tile = aVertex >> 21;
+
+    // genFace starts x quads at the far corner and mirrors u on x and top faces
+    uvec2 corner = quad_corners[gl_VertexID & 3];
+    if (face < 2u) corner.y ^= 1u;
+    else if (face == 2u) corner.x ^= 1u;
+
+    // chunks are only ever translated, so normals need no transforming
+    fragPos = pos + aChunkOffset;
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+    faceNormal = face_normals[face];
+    texCoord = (vec2(tile & 63u, tile >> 6) + vec2(corner)) * tile_size;
+}
@@ -1,6 +1,7 @@
 #include "../headers/program.h"
 #include "../headers/camera.h"
 #include "../headers/generation.h"
+#include "../headers/gpu_timer.h"
 #include <unordered_set>
 
 #include "imgui.h"
@@ -50,6 +51,7 @@ int main() {
 
     std::cout << "Successfully initialized OpenGL!" << std::endl;
     std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+    std::cout << "Perlin kernels: " << perlin_get_kernels().name << std::endl;
 
     // === IMGUI: 2. Initialize ImGui ===
     IMGUI_CHECKVERSION();
@@ -71,6 +73,12 @@ int main() {
     generator* gen = new generator(ShaderProgram);
     camera::updateCamera();
 
+    // the passes timed every frame, shown in the control panel
+    enum { PASS_TERRAIN, PASS_GIZMO, PASS_IMGUI, PASS_COUNT };
+    const char* pass_names[PASS_COUNT] = {"terrain", "gizmo", "imgui"};
+    gpu_timer timer;
+    timer.init(PASS_COUNT);
+
     float lastFrame = glfwGetTime();
     int frame_count = 0;
     float acc_time = 0;
@@ -159,6 +167,17 @@ int main() {
             ImGui::Text("Press TAB to switch between game and UI mode.");
             ImGui::ColorEdit3("Background Color", (float*)&clear_color);
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+            // gpu: time the pass took on the GPU, cpu: time spent issuing it
+            for (int pass = 0; pass < PASS_COUNT; pass++) {
+                ImGui::PushID(pass);
+                char overlay[64];
+                snprintf(overlay, sizeof(overlay), "gpu %.3f ms", timer.gpu_average(pass));
+                ImGui::PlotHistogram(pass_names[pass], timer.gpu_history(pass), gpu_timer::kHistory, timer.history_offset(), overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+                snprintf(overlay, sizeof(overlay), "cpu %.3f ms", timer.cpu_average(pass));
+                ImGui::PlotHistogram("##cpu", timer.cpu_history(pass), gpu_timer::kHistory, timer.history_offset(), overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+                ImGui::PopID();
+            }
             ImGui::End();
         }
 
@@ -178,16 +197,16 @@ int main() {
         glUseProgram(ShaderProgram->get_id());
         glUniform3fv(glGetUniformLocation(ShaderProgram->get_id(), "light_position"), 1, glm::value_ptr(light_position));
 
-        std::unordered_set<glm::ivec3, IVec3Hash> current_required_chunks;
-        generator_helper::calculate_required_chunks(current_required_chunks);
-
-        gen->prune_unnecessary_chunks(current_required_chunks);
-        gen->start_generation_tasks(current_required_chunks);
+        gen->update_region();
+        gen->start_generation_tasks(projection * view);
         gen->print_task_count();
-        gen->process_finished_mesh(current_required_chunks);
+        gen->process_finished_mesh();
         gen->print_task_count();
+        timer.begin(PASS_TERRAIN);
         gen->draw_all(ShaderProgram, view, projection);
+        timer.end(PASS_TERRAIN);
 
+        timer.begin(PASS_GIZMO);
         glUseProgram(CrosshairProgram->get_id());
         glm::mat4 gizmoModel = glm::mat4(1.0f);
         glm::vec3 gizmoPos = cameraPos + front * 3.0f; 
@@ -200,9 +219,13 @@ int main() {
         glLineWidth(3.0f);
         glBindVertexArray(CVAO);
         glDrawArrays(GL_LINES, 0, 6);
+        timer.end(PASS_GIZMO);
 
+        timer.begin(PASS_IMGUI);
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        timer.end(PASS_IMGUI);
+        timer.end_frame();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -217,6 +240,7 @@ int main() {
     // glDeleteVertexArrays(1, &VAO);
     // glDeleteBuffers(1, &VBOPos);
     // glDeleteBuffers(1, &VBONormals);
+    timer.destroy();
     glDeleteProgram(ShaderProgram->get_id());
     delete ShaderProgram;
 
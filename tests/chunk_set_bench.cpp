@@ -0,0 +1,101 @@
+#include "../headers/program.h"
+#include "../headers/generation.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+// the wanted region (15^3 chunks) following a camera, kept in each kind of
+// container: filled once, then moved 400 single chunk steps. each step drops
+// the slab left behind, adds the new one and looks up a whole box, about what
+// update_region and the generation queues do per chunk the camera crosses
+
+// what IVec3Hash used to be: std::hash<int> is the identity on libstdc++, so
+// neighbouring chunks land in the same few buckets
+struct xor_shift_hash {
+    size_t operator() (const glm::ivec3& v) const {
+        size_t h1 = std::hash<int>{}(v.x), h2 = std::hash<int>{}(v.y), h3 = std::hash<int>{}(v.z);
+        return h1 ^ (h2 << 1) ^ (h3 << 2);
+    }
+};
+
+static const int kSteps = 400;
+
+// microseconds per step. hits counts the lookups found, so they can't be optimized out
+template <typename Insert, typename Erase, typename Count>
+static double walk (Insert insert, Erase erase, Count count, long& hits) {
+    const int radius = wanted_region::radius;
+    glm::ivec3 center(0, 3, 0);
+    std::mt19937 rng(9);
+
+    auto start = std::chrono::steady_clock::now();
+    wanted_region::for_each(center, radius, insert);
+    for (int step = 0; step < kSteps; step++) {
+        glm::ivec3 next = center;
+        next[rng() % 3] += rng() % 2 ? 1 : -1;
+        wanted_region::for_each_outside(center, next, radius, erase);
+        wanted_region::for_each_outside(next, center, radius, insert);
+        center = next;
+        wanted_region::for_each(center + glm::ivec3(1, 0, 0), radius, [&](glm::ivec3 p) { hits += count(p); });
+    }
+    std::chrono::duration<double, std::micro> t = std::chrono::steady_clock::now() - start;
+    return t.count() / kSteps;
+}
+
+template <typename Set>
+static double walk_set (Set& set, long& hits) {
+    return walk([&](glm::ivec3 p) { set.insert(p); }, [&](glm::ivec3 p) { set.erase(p); },
+                [&](glm::ivec3 p) { return set.count(p); }, hits);
+}
+
+template <typename Map>
+static double walk_map (Map& map, long& hits) {
+    return walk([&](glm::ivec3 p) { map.emplace(p, chunk_record{}); }, [&](glm::ivec3 p) { map.erase(p); },
+                [&](glm::ivec3 p) { return map.count(p); }, hits);
+}
+
+// how evenly the region spreads over the buckets
+template <typename Container>
+static void print_buckets (const char* name, const Container& c) {
+    size_t used = 0, longest = 0;
+    for (size_t b = 0; b < c.bucket_count(); b++) {
+        used += c.bucket_size(b) > 0;
+        longest = std::max(longest, c.bucket_size(b));
+    }
+    std::printf("  %-40s %zu chunks in %zu of %zu buckets, longest chain %zu\n", name, c.size(), used, c.bucket_count(), longest);
+}
+
+int main () {
+    std::unordered_set<glm::ivec3, xor_shift_hash> old_set;
+    std::unordered_set<glm::ivec3, IVec3Hash> new_set;
+    std::unordered_map<glm::ivec3, chunk_record, xor_shift_hash> old_map;
+    std::unordered_map<glm::ivec3, chunk_record, IVec3Hash> new_map;
+    chunk_set flat;
+
+    long hits[5] = {};
+    double t[5];
+    t[0] = walk_set(old_set, hits[0]);
+    t[1] = walk_set(new_set, hits[1]);
+    t[2] = walk_map(old_map, hits[2]);
+    t[3] = walk_map(new_map, hits[3]);
+    t[4] = walk_set(flat, hits[4]);
+
+    std::printf("per step (%d steps):\n", kSteps);
+    std::printf("  %-40s %8.1f us\n", "unordered_set, old hash", t[0]);
+    std::printf("  %-40s %8.1f us\n", "unordered_set, IVec3Hash", t[1]);
+    std::printf("  %-40s %8.1f us\n", "unordered_map<chunk_record>, old hash", t[2]);
+    std::printf("  %-40s %8.1f us\n", "unordered_map<chunk_record>, IVec3Hash", t[3]);
+    std::printf("  %-40s %8.1f us\n", "chunk_set", t[4]);
+
+    print_buckets("old hash", old_set);
+    print_buckets("IVec3Hash", new_set);
+
+    // every container has to have seen the same region
+    for (int i = 1; i < 5; i++)
+        if (hits[i] != hits[0]) {
+            std::printf("lookups disagree: %ld vs %ld\n", hits[i], hits[0]);
+            return 1;
+        }
+}
@@ -0,0 +1,39 @@
+#include "../headers/chunk_set.h"
+
+#include <cstdio>
+#include <random>
+#include <set>
+#include <tuple>
+
+// chunk_set against std::set over random inserts and erases in a small box,
+// so runs collide, wrap around the table and get shifted back by erase
+
+static const int kOps = 2000000;
+
+int main () {
+    std::mt19937 rng(1);
+    chunk_set set;
+    std::set<std::tuple<int, int, int>> ref;
+    int bad = 0;
+
+    for (int i = 0; i < kOps; i++) {
+        glm::ivec3 p(rng() % 40 - 20, rng() % 10 - 5, rng() % 40 - 20);
+        std::tuple<int, int, int> key(p.x, p.y, p.z);
+        if (rng() % 3) bad += set.insert(p) != ref.insert(key).second;
+        else           bad += set.erase(p) != (ref.erase(key) == 1);
+
+        // now and then the whole contents, both ways
+        if (i % 10000 == 0) {
+            for (const auto& [x, y, z] : ref) bad += !set.count(glm::ivec3(x, y, z));
+            size_t n = 0;
+            for (glm::ivec3 q : set) {
+                bad += !ref.count(std::tuple<int, int, int>(q.x, q.y, q.z));
+                n++;
+            }
+            bad += n != ref.size() || set.size() != ref.size();
+        }
+    }
+
+    std::printf("%d ops, %d mismatches with std::set\n", kOps, bad);
+    return bad == 0 ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#include "../headers/helpers.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// a warmed up mesher must not touch the heap: once the thread's scratch has
+// grown to fit the chunks it sees, meshing them again allocates nothing
+
+static size_t allocations = 0;
+
+void* operator new (size_t n) {
+    allocations++;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[] (size_t n) { return operator new(n); }
+void operator delete (void* p) noexcept { std::free(p); }
+void operator delete[] (void* p) noexcept { std::free(p); }
+void operator delete (void* p, size_t) noexcept { std::free(p); }
+void operator delete[] (void* p, size_t) noexcept { std::free(p); }
+
+// every chunk of a small region, both noise rates, as generation jobs mesh them
+static size_t mesh_region () {
+    size_t quads = 0;
+    uint32_t face_quads[6];
+    for (f32 max_error : { 0.0f, COARSE_NOISE_MAX_ERROR })
+        for (int x = -3; x < 3; x++)
+            for (int y = -3; y < 3; y++)
+                for (int z = -2; z < 2; z++)
+                    quads += generator_helper::mesh_chunk(glm::ivec3(x, y, z), face_quads, max_error).size() / 4;
+    return quads;
+}
+
+int main () {
+    mesh_region(); // warm up
+
+    size_t before = allocations;
+    size_t quads = mesh_region();
+    size_t during = allocations - before;
+
+    std::printf("%zu quads, %zu allocations\n", quads, during);
+    return during == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#include "../headers/helpers.h"
+
+#include <cstdio>
+#include <random>
+
+// the mesher against brute force: for a fixed set of chunks, at full rate
+// and with coarse noise, the quads mesh_chunk emits have to cover exactly
+// the exposed unit faces of the solid voxels, each once, and sit in the
+// group of their face id
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { failures++; std::printf("FAIL %s:%d: ", __FILE__, __LINE__); std::printf(__VA_ARGS__); std::printf("\n"); } } while (0)
+
+static const int N = CHUNK_LENGTH + 2; // padded chunk side
+
+// solid voxels of the padded chunk at pos, from the density volume itself
+// rather than the thresholding kernel mesh_chunk uses
+static void solid_voxels (glm::ivec3 pos, f32 max_error, std::vector<bool>& solid) {
+    const perlin_kernels& noise = perlin_get_kernels();
+    f32 f = 1.0f / 32.0f;
+    f32 x = (-1 + pos.x * CHUNK_LENGTH + 10000) * f;
+    f32 y = (-1 + pos.y * CHUNK_LENGTH + 10000) * f;
+    f32 z = (-1 + pos.z * CHUNK_LENGTH + 10000) * f;
+
+    std::vector<f32> density(N * N * N);
+    u32 step = max_error > 0 ? perlin_coarse_step(f, max_error) : 1;
+    if (step > 1) noise.perlinNoiseVolumeCoarse(x, y, z, N, N, N, f, step, density.data());
+    else          noise.perlinNoiseVolume(x, y, z, N, N, N, f, density.data());
+
+    solid.resize(N * N * N);
+    for (int i = 0; i < N * N * N; i++) solid[i] = density[i] >= PERLIN_DENSITY_THRESHOLD;
+}
+
+static void test_chunk (glm::ivec3 pos, f32 max_error) {
+    std::vector<bool> solid;
+    solid_voxels(pos, max_error, solid);
+    auto at = [&](int x, int y, int z) { return (bool)solid[(z * N + y) * N + x]; };
+
+    // times each unit face (face id, inner voxel) is covered by a quad
+    std::vector<uint8_t> covered(6 * CHUNK_LENGTH * CHUNK_LENGTH * CHUNK_LENGTH);
+    auto face_index = [](int face, int x, int y, int z) { return ((face * CHUNK_LENGTH + z) * CHUNK_LENGTH + y) * CHUNK_LENGTH + x; };
+
+    uint32_t face_quads[6];
+    std::span<const uint32_t> vertices = generator_helper::mesh_chunk(pos, face_quads, max_error);
+
+    size_t quads = 0;
+    for (int face = 0; face < 6; face++) quads += face_quads[face];
+    CHECK(vertices.size() == quads * 4, "chunk (%d %d %d): %zu vertices for %zu quads", pos.x, pos.y, pos.z, vertices.size(), quads);
+
+    size_t q = 0;
+    for (int group = 0; group < 6; group++) {
+        for (uint32_t n = 0; n < face_quads[group]; n++, q++) {
+            int lo[3] = {63, 63, 63}, hi[3] = {0, 0, 0};
+            for (int v = 0; v < 4; v++) {
+                uint32_t packed = vertices[q * 4 + v];
+                int p[3] = {(int)(packed & 63), (int)(packed >> 6 & 63), (int)(packed >> 12 & 63)};
+                int face = packed >> 18 & 7;
+                CHECK(face == group, "chunk (%d %d %d): quad %zu in group %d has face %d", pos.x, pos.y, pos.z, q, group, face);
+                for (int a = 0; a < 3; a++) {
+                    lo[a] = std::min(lo[a], p[a]);
+                    hi[a] = std::max(hi[a], p[a]);
+                }
+            }
+
+            // the quad is flat along its axis, and the voxel it belongs to
+            // is behind the plane for + faces and in front of it for - faces
+            int axis = group / 2;
+            CHECK(lo[axis] == hi[axis], "chunk (%d %d %d): quad %zu is not flat", pos.x, pos.y, pos.z, q);
+            if (group % 2 == 0) lo[axis]--;
+            hi[axis] = lo[axis] + 1;
+
+            for (int z = lo[2]; z < hi[2]; z++)
+                for (int y = lo[1]; y < hi[1]; y++)
+                    for (int x = lo[0]; x < hi[0]; x++)
+                        if (x >= 0 && y >= 0 && z >= 0 && x < CHUNK_LENGTH && y < CHUNK_LENGTH && z < CHUNK_LENGTH)
+                            covered[face_index(group, x, y, z)]++;
+                        else
+                            CHECK(false, "chunk (%d %d %d): quad %zu leaves the chunk", pos.x, pos.y, pos.z, q);
+        }
+    }
+
+    // brute force: every face of an inner solid voxel whose neighbour is empty
+    static const int dir[6][3] = {{1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}};
+    int wrong = 0;
+    for (int face = 0; face < 6; face++)
+        for (int z = 0; z < CHUNK_LENGTH; z++)
+            for (int y = 0; y < CHUNK_LENGTH; y++)
+                for (int x = 0; x < CHUNK_LENGTH; x++) {
+                    bool exposed = at(x+1, y+1, z+1) && !at(x+1 + dir[face][0], y+1 + dir[face][1], z+1 + dir[face][2]);
+                    int count = covered[face_index(face, x, y, z)];
+                    if (count != (int)exposed && wrong++ < 5)
+                        CHECK(false, "chunk (%d %d %d) max_error %g: face %d of voxel (%d %d %d) covered %d times, exposed %d",
+                              pos.x, pos.y, pos.z, max_error, face, x, y, z, count, (int)exposed);
+                }
+    if (wrong > 5) CHECK(false, "chunk (%d %d %d) max_error %g: %d faces wrong in total", pos.x, pos.y, pos.z, max_error, wrong);
+}
+
+static void test_transpose () {
+    std::mt19937 rng(1);
+    for (int n = 0; n < 1000; n++) {
+        uint32_t m[32], t[32];
+        for (int i = 0; i < 32; i++) m[i] = t[i] = rng();
+
+        generator_helper::transpose_32x32(t);
+        bool same = true;
+        for (int i = 0; i < 32; i++)
+            for (int j = 0; j < 32; j++)
+                same &= (m[i] >> j & 1) == (t[j] >> i & 1);
+        CHECK(same, "transpose_32x32 of matrix %d is not the transpose", n);
+
+        generator_helper::transpose_32x32(t);
+        bool back = true;
+        for (int i = 0; i < 32; i++) back &= m[i] == t[i];
+        CHECK(back, "transpose_32x32 twice doesn't give matrix %d back", n);
+    }
+}
+
+int main () {
+    test_transpose();
+
+    for (f32 max_error : { 0.0f, COARSE_NOISE_MAX_ERROR })
+        for (int x = -2; x < 2; x++)
+            for (int y = -2; y < 2; y++)
+                for (int z = -1; z < 1; z++)
+                    test_chunk(glm::ivec3(x, y, z), max_error);
+
+    if (failures) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "perlin.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// noise throughput of every kernel variant the cpu can run, over the 34^3
+// blocks mesh_chunk samples (a chunk plus its one voxel border): single
+// octave volumes, then fBm and ridged fractals.
+// numbers are only meaningful in an optimized build (-DCMAKE_BUILD_TYPE=Release)
+
+static const u32 N = 34;
+static const int kChunks = 20;
+static const f32 f = 1.0f / 32;
+
+typedef std::chrono::high_resolution_clock clock_type;
+
+// sample origin of chunk i, the same way mesh_chunk computes it
+static void chunk_origin (int i, f32& x, f32& y, f32& z) {
+    x = (-1 + (i % 5 - 2) * 32 + 10000) * f;
+    y = (-1 + (i / 5 % 2) * 32 + 10000) * f;
+    z = (-1 + (i / 10) * 32 + 10000) * f;
+}
+
+// one perlinNoiseSIMD_4x_f32 call per 4 voxels of a row, how noise was
+// sampled before perlinNoiseVolume
+static void volume_by_4x (const perlin_kernels& k, f32 x, f32 y, f32 z, f32* data) {
+    f32 v[4];
+    for (u32 kz = 0; kz < N; kz++)
+        for (u32 j = 0; j < N; j++)
+            for (u32 i = 0; i < N; i += 4) {
+                k.perlinNoiseSIMD_4x_f32(x + i * f, y + j * f, z + kz * f, f, v);
+                for (u32 l = 0; l < 4 && i + l < N; l++) data[(kz * N + j) * N + i + l] = v[l];
+            }
+}
+
+// one perlinNoiseVolume per octave, summed afterwards: what
+// perlinFractalVolume does in a single pass
+static void fractal_by_octaves (const perlin_kernels& k, f32 x, f32 y, f32 z, const perlin_fractal& fractal, f32* octave, f32* data) {
+    f32 frequency = 1, amp = 1, amp_sum = 0;
+    for (u32 i = 0; i < N * N * N; i++) data[i] = 0;
+    for (u32 n = 0; n < fractal.octaves; n++) {
+        f32 offset = n * 19.19f;   // same per octave offset as the kernel
+        k.perlinNoiseVolume(x * frequency + offset, y * frequency + offset, z * frequency + offset, N, N, N, f * frequency, octave);
+        for (u32 i = 0; i < N * N * N; i++) {
+            f32 value = octave[i];
+            if (fractal.type == PERLIN_RIDGED) value = (1 - std::fabs(value)) * (1 - std::fabs(value));
+            data[i] += amp * value;
+        }
+        amp_sum += amp;
+        frequency *= fractal.lacunarity;
+        amp *= fractal.gain;
+    }
+    bool ridged = fractal.type == PERLIN_RIDGED;
+    for (u32 i = 0; i < N * N * N; i++) data[i] = ridged ? data[i] * 2 / amp_sum - 1 : data[i] / amp_sum;
+}
+
+// best of a few runs over all the chunks, in voxels per second
+template <typename Fn>
+static double rate (Fn fn) {
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        auto start = clock_type::now();
+        for (int i = 0; i < kChunks; i++) fn(i);
+        std::chrono::duration<double> t = clock_type::now() - start;
+        if (t.count() < best) best = t.count();
+    }
+    return (double)N * N * N * kChunks / best;
+}
+
+int main () {
+    const perlin_kernels* kernels[PERLIN_MAX_KERNELS];
+    int count = perlin_supported_kernels(kernels);
+
+    std::vector<f32> a(N * N * N), b(N * N * N), octave(N * N * N);
+
+    std::printf("%-8s %14s %14s %8s %10s\n", "kernels", "4x loop Mv/s", "volume Mv/s", "speedup", "max diff");
+    for (int v = 0; v < count; v++) {
+        const perlin_kernels& k = *kernels[v];
+
+        double loop = rate([&](int i) { f32 x, y, z; chunk_origin(i, x, y, z); volume_by_4x(k, x, y, z, a.data()); });
+        double volume = rate([&](int i) { f32 x, y, z; chunk_origin(i, x, y, z); k.perlinNoiseVolume(x, y, z, N, N, N, f, b.data()); });
+
+        // both paths have to agree on the last chunk, or the timing means nothing
+        f32 diff = 0;
+        for (size_t i = 0; i < a.size(); i++) diff = std::fmax(diff, std::fabs(a[i] - b[i]));
+
+        std::printf("%-8s %14.1f %14.1f %7.2fx %10.2g\n", k.name, loop / 1e6, volume / 1e6, volume / loop, diff);
+    }
+
+    std::printf("\n%-8s %-7s %7s %14s %14s %8s %10s\n", "kernels", "type", "octaves", "split Mv/s", "fused Mv/s", "speedup", "max diff");
+    for (int v = 0; v < count; v++) {
+        const perlin_kernels& k = *kernels[v];
+
+        for (perlin_fractal_type type : { PERLIN_FBM, PERLIN_RIDGED }) {
+            for (u32 octaves : { 1, 2, 4, 8 }) {
+                perlin_fractal fractal;
+                fractal.octaves = octaves;
+                fractal.type = type;
+
+                double split = rate([&](int i) { f32 x, y, z; chunk_origin(i, x, y, z); fractal_by_octaves(k, x, y, z, fractal, octave.data(), a.data()); });
+                double fused = rate([&](int i) { f32 x, y, z; chunk_origin(i, x, y, z); k.perlinFractalVolume(x, y, z, N, N, N, f, fractal, b.data()); });
+
+                f32 diff = 0;
+                for (size_t i = 0; i < a.size(); i++) diff = std::fmax(diff, std::fabs(a[i] - b[i]));
+
+                std::printf("%-8s %-7s %7u %14.1f %14.1f %7.2fx %10.2g\n", k.name, type == PERLIN_FBM ? "fbm" : "ridged",
+                            octaves, split / 1e6, fused / 1e6, fused / split, diff);
+            }
+        }
+    }
+}